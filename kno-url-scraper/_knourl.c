@@ -0,0 +1,397 @@
+/*
+ * Kusanagi Night Ops: URL Scrapper - _knourl accelerator for kno-url.py
+ *
+ *   cc -O2 -shared -fPIC $(python3-config --includes) \
+ *      -o _knourl$(python3-config --extension-suffix) _knourl.c
+ *
+ * Drop the built module next to kno-url.py and it is picked up on start;
+ * without it kno-url.py uses its regex / urlparse code. Results are the same
+ * either way:
+ *
+ *   extract(html) -> (set, schemeless, fragments)
+ *       One pass per regex of extract_urls_from_html, same matching rules
+ *       (findall order, \s as str.isspace, the blob: and ':' lookbehinds),
+ *       run with the GIL released. Scheme-relative // matches and #fragment
+ *       hrefs come back as lists for the caller to prefix / urljoin.
+ *
+ *   classify(url) -> (category, ext) or None
+ *       categorize_url_html() and the sort extension from one urlparse-
+ *       equivalent split (Python 3.9+ rules). Returns None for anything the
+ *       port does not cover (non-ASCII, control characters, brackets), so
+ *       the caller falls back to urlparse.
+ *
+ *   configure(script_ext, media_ext, doc_ext, html_ext, suffixes)
+ *       Hands over the category sets from kno-url.py so they stay defined
+ *       in one place, and reads urllib.parse.uses_params from the running
+ *       Python. classify() returns None until this is called.
+ */
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <string.h>
+
+/* ---------- Extraction ---------- */
+enum { SPAN_ABS, SPAN_SCHEMELESS, SPAN_FRAGMENT };
+
+typedef struct {
+    Py_ssize_t start, end;
+    int kind;
+} Span;
+
+typedef struct {
+    Span *items;
+    size_t count, cap;
+    int oom;
+} SpanList;
+
+/* Runs without the GIL, so only the raw allocator is used. */
+static void span_add(SpanList *l, Py_ssize_t start, Py_ssize_t end, int kind) {
+    if (l->count == l->cap) {
+        size_t nc = l->cap ? l->cap * 2 : 256;
+        Span *ni = (Span *)PyMem_RawRealloc(l->items, nc * sizeof(Span));
+        if (!ni) {
+            l->oom = 1;
+            return;
+        }
+        l->items = ni;
+        l->cap = nc;
+    }
+    l->items[l->count].start = start;
+    l->items[l->count].end = end;
+    l->items[l->count].kind = kind;
+    l->count++;
+}
+
+/* [^\s'"<>] for a str pattern: \s is Py_UNICODE_ISSPACE. */
+#define URL_CHAR(c) ((c) != '\'' && (c) != '"' && (c) != '<' && (c) != '>' && !Py_UNICODE_ISSPACE(c))
+
+/*
+ * One scanner per PEP 393 storage width. Each loop is one findall(): on a
+ * match scanning resumes at its end, otherwise at the next position.
+ */
+#define DEFINE_SCAN(NAME, T)                                                          \
+static Py_ssize_t NAME##_run(const T *s, Py_ssize_t n, Py_ssize_t i) {                \
+    Py_ssize_t e = i;                                                                 \
+    while (e < n && URL_CHAR(s[e])) e++;                                              \
+    return e;                                                                         \
+}                                                                                     \
+                                                                                      \
+static int NAME##_lit(const T *s, Py_ssize_t n, Py_ssize_t i, const char *lit) {      \
+    for (; *lit; lit++, i++) {                                                        \
+        if (i >= n || s[i] != (T)(unsigned char)*lit) return 0;                       \
+    }                                                                                 \
+    return 1;                                                                         \
+}                                                                                     \
+                                                                                      \
+static void NAME(const T *s, Py_ssize_t n, SpanList *out) {                           \
+    Py_ssize_t i, j, e;                                                               \
+    /* (?<!blob:)https?://[^\s'"<>]+ */                                               \
+    for (i = 0; i < n;) {                                                             \
+        if (s[i] == 'h' && NAME##_lit(s, n, i, "http") &&                             \
+            !(i >= 5 && NAME##_lit(s, n, i - 5, "blob:"))) {                          \
+            j = i + 4;                                                                \
+            if (j < n && s[j] == 's') j++;                                            \
+            if (NAME##_lit(s, n, j, "://") && (e = NAME##_run(s, n, j + 3)) > j + 3) { \
+                span_add(out, i, e, SPAN_ABS);                                        \
+                i = e;                                                                \
+                continue;                                                             \
+            }                                                                         \
+        }                                                                             \
+        i++;                                                                          \
+    }                                                                                 \
+    /* blob:[^\s'"<>]+ */                                                             \
+    for (i = 0; i < n;) {                                                             \
+        if (s[i] == 'b' && NAME##_lit(s, n, i, "blob:") &&                            \
+            (e = NAME##_run(s, n, i + 5)) > i + 5) {                                  \
+            span_add(out, i, e, SPAN_ABS);                                            \
+            i = e;                                                                    \
+            continue;                                                                 \
+        }                                                                             \
+        i++;                                                                          \
+    }                                                                                 \
+    /* (?<!:)//[^\s'"<>]+ */                                                          \
+    for (i = 0; i + 1 < n;) {                                                         \
+        if (s[i] == '/' && s[i + 1] == '/' && (i == 0 || s[i - 1] != ':') &&          \
+            (e = NAME##_run(s, n, i + 2)) > i + 2) {                                  \
+            span_add(out, i, e, SPAN_SCHEMELESS);                                     \
+            i = e;                                                                    \
+            continue;                                                                 \
+        }                                                                             \
+        i++;                                                                          \
+    }                                                                                 \
+    /* href=['"](#.+?)['"]  ('.' is anything but \n, the first one included) */      \
+    for (i = 0; i < n;) {                                                             \
+        if (s[i] == 'h' && NAME##_lit(s, n, i, "href=") && i + 7 < n &&               \
+            (s[i + 5] == '\'' || s[i + 5] == '"') && s[i + 6] == '#' &&               \
+            s[i + 7] != '\n') {                                                       \
+            for (j = i + 8; j < n && s[j] != '\n'; j++) {                             \
+                if (s[j] == '\'' || s[j] == '"') break;                               \
+            }                                                                         \
+            if (j < n && s[j] != '\n') {                                              \
+                span_add(out, i + 6, j, SPAN_FRAGMENT);                               \
+                i = j + 1;                                                            \
+                continue;                                                             \
+            }                                                                         \
+        }                                                                             \
+        i++;                                                                          \
+    }                                                                                 \
+}
+
+DEFINE_SCAN(scan_ucs1, Py_UCS1)
+DEFINE_SCAN(scan_ucs2, Py_UCS2)
+DEFINE_SCAN(scan_ucs4, Py_UCS4)
+
+static PyObject *knourl_extract(PyObject *self, PyObject *arg) {
+    SpanList spans = { NULL, 0, 0, 0 };
+    PyObject *found = NULL, *schemeless = NULL, *fragments = NULL, *result = NULL;
+    (void)self;
+
+    if (!PyUnicode_Check(arg)) {
+        PyErr_SetString(PyExc_TypeError, "extract() expects str");
+        return NULL;
+    }
+    if (PyUnicode_READY(arg) < 0) return NULL;
+
+    int kind = PyUnicode_KIND(arg);
+    const void *data = PyUnicode_DATA(arg);
+    Py_ssize_t n = PyUnicode_GET_LENGTH(arg);
+
+    /* str is immutable and we hold a reference, so the buffer stays valid. */
+    Py_BEGIN_ALLOW_THREADS
+    if (kind == PyUnicode_1BYTE_KIND) scan_ucs1((const Py_UCS1 *)data, n, &spans);
+    else if (kind == PyUnicode_2BYTE_KIND) scan_ucs2((const Py_UCS2 *)data, n, &spans);
+    else scan_ucs4((const Py_UCS4 *)data, n, &spans);
+    Py_END_ALLOW_THREADS
+
+    if (spans.oom) {
+        PyErr_NoMemory();
+        goto done;
+    }
+    if (!(found = PySet_New(NULL)) || !(schemeless = PyList_New(0)) || !(fragments = PyList_New(0))) goto done;
+    for (size_t k = 0; k < spans.count; k++) {
+        const Span *sp = &spans.items[k];
+        PyObject *u = PyUnicode_Substring(arg, sp->start, sp->end);
+        int rc;
+        if (!u) goto done;
+        if (sp->kind == SPAN_ABS) rc = PySet_Add(found, u);
+        else rc = PyList_Append(sp->kind == SPAN_SCHEMELESS ? schemeless : fragments, u);
+        Py_DECREF(u);
+        if (rc < 0) goto done;
+    }
+    result = PyTuple_Pack(3, found, schemeless, fragments);
+
+done:
+    PyMem_RawFree(spans.items);
+    Py_XDECREF(found);
+    Py_XDECREF(schemeless);
+    Py_XDECREF(fragments);
+    return result;
+}
+
+/* ---------- Categorization ---------- */
+static PyObject *g_script_ext, *g_media_ext, *g_doc_ext, *g_html_ext, *g_suffixes;
+static PyObject *g_uses_params;     /* frozenset(urllib.parse.uses_params): schemes urlparse() splits ;params for */
+static PyObject *g_cat_names[6];
+
+enum { CAT_SCRIPTS, CAT_MEDIA, CAT_API, CAT_DOCS, CAT_HTML, CAT_OTHER };
+
+static const char *k_cat_names[6] = {
+    "SCRIPTS", "MEDIA", "API / ENDPOINTS", "DOCUMENTS / CONFIG", "HTML / FRAMEWORK", "OTHER"
+};
+
+static int is_scheme_char(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+           c == '+' || c == '-' || c == '.';
+}
+
+static const char *find_in(const char *p, const char *end, char c) {
+    return p < end ? (const char *)memchr(p, c, (size_t)(end - p)) : NULL;
+}
+
+static int contains(const char *p, size_t n, const char *needle) {
+    size_t k = strlen(needle);
+    for (size_t i = 0; i + k <= n; i++) {
+        if (memcmp(p + i, needle, k) == 0) return 1;
+    }
+    return 0;
+}
+
+/* os.path.splitext(p)[1]: the last dot after the last separator, unless the name is all leading dots. */
+static size_t splitext_at(const char *p, size_t n) {
+    Py_ssize_t sep = -1, dot = -1;
+    for (size_t i = 0; i < n; i++) {
+#ifdef _WIN32
+        if (p[i] == '/' || p[i] == '\\') sep = (Py_ssize_t)i;
+#else
+        if (p[i] == '/') sep = (Py_ssize_t)i;
+#endif
+        else if (p[i] == '.') dot = (Py_ssize_t)i;
+    }
+    if (dot > sep) {
+        for (Py_ssize_t k = sep + 1; k < dot; k++) {
+            if (p[k] != '.') return (size_t)dot;
+        }
+    }
+    return n;
+}
+
+static PyObject *knourl_classify(PyObject *self, PyObject *arg) {
+    char stack[512];
+    char *buf = stack;
+    PyObject *ext = NULL, *result = NULL;
+    int cat = CAT_OTHER;
+    (void)self;
+
+    if (!PyUnicode_Check(arg)) {
+        PyErr_SetString(PyExc_TypeError, "classify() expects str");
+        return NULL;
+    }
+    if (!g_script_ext || PyUnicode_READY(arg) < 0 || !PyUnicode_IS_ASCII(arg)) {
+        if (PyErr_Occurred()) return NULL;
+        Py_RETURN_NONE;
+    }
+    const char *s = (const char *)PyUnicode_DATA(arg);
+    size_t n = (size_t)PyUnicode_GET_LENGTH(arg);
+    for (size_t i = 0; i < n; i++) {
+        /* urlsplit strips / removes controls and spaces, and validates brackets. */
+        if ((unsigned char)s[i] <= ' ' || s[i] == 0x7f || s[i] == '[' || s[i] == ']') Py_RETURN_NONE;
+    }
+
+    /* urlsplit(): scheme, netloc, then #fragment and ?query off the rest. */
+    const char *p = s, *end = s + n;
+    const char *scheme = s;
+    size_t scheme_len = 0;
+    const char *colon = find_in(s, end, ':');
+    if (colon && colon > s && ((s[0] | 0x20) >= 'a' && (s[0] | 0x20) <= 'z')) {
+        const char *c = s;
+        while (c < colon && is_scheme_char(*c)) c++;
+        if (c == colon) {
+            scheme_len = (size_t)(colon - s);
+            p = colon + 1;
+        }
+    }
+    const char *netloc = p;
+    size_t netloc_len = 0;
+    if (end - p >= 2 && p[0] == '/' && p[1] == '/') {
+        const char *q = p + 2;
+        while (q < end && *q != '/' && *q != '?' && *q != '#') q++;
+        netloc = p + 2;
+        netloc_len = (size_t)(q - netloc);
+        p = q;
+    }
+    const char *hash = find_in(p, end, '#');
+    if (hash) end = hash;
+    const char *qmark = find_in(p, end, '?');
+    int have_query = qmark && qmark + 1 < end;
+    if (qmark) end = qmark;
+
+    /* urlparse(): ;params off the last segment for the uses_params schemes. */
+    if (find_in(p, end, ';')) {
+        char lower[64];
+        PyObject *key;
+        int params = 0;
+        /* urlsplit lowers the scheme; one longer than any listed cannot match. */
+        if (scheme_len < sizeof(lower)) {
+            for (size_t i = 0; i < scheme_len; i++) lower[i] = (char)Py_TOLOWER(scheme[i]);
+            if (!(key = PyUnicode_FromStringAndSize(lower, (Py_ssize_t)scheme_len))) goto done;
+            params = PySet_Contains(g_uses_params, key);
+            Py_DECREF(key);
+            if (params < 0) goto done;
+        }
+        if (params) {
+            const char *from = p, *semi;
+            for (const char *c = p; c < end; c++) {
+                if (*c == '/') from = c;
+            }
+            if ((semi = find_in(from, end, ';')) != NULL) end = semi;
+        }
+    }
+
+    /* categorize_url_html() on the lowered path. */
+    size_t plen = (size_t)(end - p);
+    size_t need = netloc_len + plen;
+    if (need + 1 > sizeof(stack) && !(buf = (char *)PyMem_Malloc(need + 1))) return PyErr_NoMemory();
+    for (size_t i = 0; i < netloc_len; i++) buf[i] = (char)Py_TOLOWER(netloc[i]);
+    char *lowered = buf + netloc_len;
+    for (size_t i = 0; i < plen; i++) lowered[i] = (char)Py_TOLOWER(p[i]);
+    lowered[plen] = '\0';
+
+    size_t dot = splitext_at(lowered, plen);
+    if (!(ext = PyUnicode_FromStringAndSize(lowered + dot, (Py_ssize_t)(plen - dot)))) goto done;
+
+    int suffix = 0;
+    for (Py_ssize_t k = 0; k < PyTuple_GET_SIZE(g_suffixes); k++) {
+        Py_ssize_t sl;
+        const char *sfx = PyUnicode_AsUTF8AndSize(PyTuple_GET_ITEM(g_suffixes, k), &sl);
+        if (!sfx) goto done;
+        if ((size_t)sl <= plen && memcmp(lowered + plen - (size_t)sl, sfx, (size_t)sl) == 0) suffix = 1;
+    }
+
+    int hit;
+    if (suffix) cat = CAT_HTML;
+    else if ((hit = PySet_Contains(g_script_ext, ext)) != 0) cat = CAT_SCRIPTS;
+    else if ((hit = PySet_Contains(g_media_ext, ext)) != 0) cat = CAT_MEDIA;
+    else if ((hit = PySet_Contains(g_doc_ext, ext)) != 0) cat = CAT_DOCS;
+    else if ((hit = PySet_Contains(g_html_ext, ext)) != 0) cat = CAT_HTML;
+    else if (contains(lowered, plen, "/api/") || contains(buf, need, "graphql")) cat = CAT_API;
+    else if (dot == plen && have_query) cat = CAT_API;
+    if (PyErr_Occurred()) goto done;
+
+    result = PyTuple_Pack(2, g_cat_names[cat], ext);
+
+done:
+    Py_XDECREF(ext);
+    if (buf != stack) PyMem_Free(buf);
+    return result;
+}
+
+static PyObject *knourl_configure(PyObject *self, PyObject *args) {
+    PyObject *script, *media, *doc, *html, *suffixes;
+    (void)self;
+    if (!PyArg_ParseTuple(args, "O!O!O!O!O!:configure", &PySet_Type, &script, &PySet_Type, &media,
+                          &PySet_Type, &doc, &PySet_Type, &html, &PyTuple_Type, &suffixes)) {
+        return NULL;
+    }
+    PyObject *parse = PyImport_ImportModule("urllib.parse");
+    PyObject *schemes = parse ? PyObject_GetAttrString(parse, "uses_params") : NULL;
+    PyObject *uses_params = schemes ? PyFrozenSet_New(schemes) : NULL;
+    Py_XDECREF(schemes);
+    Py_XDECREF(parse);
+    if (!uses_params) return NULL;
+    for (Py_ssize_t k = 0; k < PyTuple_GET_SIZE(suffixes); k++) {
+        PyObject *sfx = PyTuple_GET_ITEM(suffixes, k);
+        if (!PyUnicode_Check(sfx) || PyUnicode_READY(sfx) < 0 || !PyUnicode_IS_ASCII(sfx)) {
+            PyErr_SetString(PyExc_ValueError, "configure() suffixes must be ASCII str");
+            Py_DECREF(uses_params);
+            return NULL;
+        }
+    }
+    Py_INCREF(script); Py_XSETREF(g_script_ext, script);
+    Py_INCREF(media); Py_XSETREF(g_media_ext, media);
+    Py_INCREF(doc); Py_XSETREF(g_doc_ext, doc);
+    Py_INCREF(html); Py_XSETREF(g_html_ext, html);
+    Py_INCREF(suffixes); Py_XSETREF(g_suffixes, suffixes);
+    Py_XSETREF(g_uses_params, uses_params);
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef knourl_methods[] = {
+    { "extract", knourl_extract, METH_O,
+      "extract(html) -> (set, schemeless, fragments)\n\nScan a page like kno-url.py's regexes, without the GIL." },
+    { "classify", knourl_classify, METH_O,
+      "classify(url) -> (category, ext) or None\n\nNone means the URL needs urlparse()." },
+    { "configure", knourl_configure, METH_VARARGS,
+      "configure(script_ext, media_ext, doc_ext, html_ext, suffixes)" },
+    { NULL, NULL, 0, NULL },
+};
+
+static struct PyModuleDef knourl_module = {
+    PyModuleDef_HEAD_INIT, "_knourl", "C accelerator for kno-url.py.", -1, knourl_methods,
+    NULL, NULL, NULL, NULL,
+};
+
+PyMODINIT_FUNC PyInit__knourl(void) {
+    for (int c = 0; c < 6; c++) {
+        if (!g_cat_names[c] && !(g_cat_names[c] = PyUnicode_InternFromString(k_cat_names[c]))) return NULL;
+    }
+    return PyModule_Create(&knourl_module);
+}
@@ -0,0 +1,392 @@
+#!/usr/bin/env python3
+"""
+Kusanagi Night Ops: URL Scrapper - cross-edition parity / performance harness
+
+Feeds the same local HTML corpus to the HTML pipeline of every edition that
+can be built here, diffs the categorized output and reports throughput and
+peak memory per edition:
+
+    python3 kno-url-parity.py [--pages 20] [--size 256k] [--seed 1]
+                              [--corpus DIR] [--repeat 3] [--reference python]
+                              [--editions c,go,python,python+_knourl]
+                              [--examples 3] [--keep]
+
+Pages are served from 127.0.0.1 by a server inside this process, so no
+external network is touched and every edition reads identical bytes through
+its own fetch path. Each edition runs its REPL once with every page (times
+--repeat) on stdin. Throughput excludes start-up, which is measured
+separately with an empty session. Peak RSS is the child's ru_maxrss.
+
+Editions:
+    c                kno-url.c built with cc and libcurl
+    go               kno-url.go built with go build
+    python           kno-url.py with the regex / urlparse path
+    python+_knourl   kno-url.py with the _knourl.c accelerator built next to it
+
+kno-url-with-network-mode.go needs playwright-go and kno-url.ps1's REPL does
+not stop at end of input, so neither is driven here.
+"""
+
+import argparse
+import os
+import random
+import re
+import shutil
+import subprocess
+import sys
+import sysconfig
+import tempfile
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+RED_TEAM = os.path.join(HERE, 'red-team-versions')
+
+CATEGORIES = ['SCRIPTS', 'MEDIA', 'API / ENDPOINTS', 'DOCUMENTS / CONFIG', 'HTML / FRAMEWORK', 'OTHER']
+ALL_EDITIONS = ['c', 'go', 'python', 'python+_knourl']
+
+
+# --------- Synthetic corpus ---------
+HOSTS = ['example.com', 'cdn.example.com', 'static.example.net', 'api.example.org',
+         'img.cdn-host.io', 'docs.example.dev', 'graphql.example.io']
+DIRS = ['/', '/assets/', '/static/js/', '/img/', '/api/v1/', '/api/v2/users/', '/docs/',
+        '/media/video/', '/blog/2024/', '/graphql', '/dl/', '/café/']
+NAMES = ['app', 'main', 'vendor', 'logo', 'hero', 'index', 'report', 'intro', 'style', 'data', 'feed']
+EXTS = ['.js', '.mjs', '.JS', '.css', '.png', '.PNG', '.jpg', '.webp', '.svg', '.mp4', '.json', '.pdf',
+        '.html', '.htm', '.php', '.bundle.js', '.chunk.js', '', '.xml', '.woff2', '.yaml']
+WORDS = ['night', 'ops', 'the', 'scraper', 'of', 'link', 'page', 'content', 'menu', 'footer',
+         'header', 'section', 'quick', 'brown', 'fox', 'lorem', 'ipsum']
+
+
+def corpus_url(rng, scheme=None):
+    """One absolute URL; scheme=None picks http or https."""
+    scheme = scheme or rng.choice(['https', 'https', 'https', 'http'])
+    d = rng.choice(DIRS)
+    if d == '/graphql':
+        u = f"{scheme}://{rng.choice(HOSTS)}{d}?op=q{rng.randrange(1000)}"
+    else:
+        u = f"{scheme}://{rng.choice(HOSTS)}{d}{rng.choice(NAMES)}-{rng.randrange(10000)}{rng.choice(EXTS)}"
+    r = rng.random()
+    if r < 0.15:
+        u += f"?v={rng.randrange(10)}"
+    elif r < 0.2:
+        u += ";jsessionid=abc"
+    elif r < 0.25:
+        u += f"#frag{rng.randrange(10)}"
+    return u
+
+
+def corpus_link(rng):
+    """A URL in one of the shapes the editions treat differently."""
+    u = corpus_url(rng)
+    r = rng.random()
+    if r < 0.45:
+        return f'<a href="{u}">{rng.choice(WORDS)}</a>'
+    if r < 0.55:
+        return f'<script src="{u.split(":", 1)[1]}"></script>'     # scheme-relative //host/...
+    if r < 0.62:
+        return f'<a href="#section-{rng.randrange(50)}">{rng.choice(WORDS)}</a>'
+    if r < 0.68:
+        return f'<img src="blob:{u}">'
+    if r < 0.76:
+        return '<script>var cfg = {"u": "' + u.replace('/', '\\/') + '"};</script>'
+    if r < 0.82:
+        return f'<a href="{u}?a=1&amp;b=2">{rng.choice(WORDS)}</a>'
+    if r < 0.88:
+        return f'({u}), {rng.choice(WORDS)}'
+    if r < 0.93:
+        return f'{u} {rng.choice(WORDS)}'                      # no-break space after the URL
+    return f"<link href='{u}'>"
+
+
+def build_corpus(pages, size, seed):
+    rng = random.Random(seed)
+    out = []
+    for n in range(pages):
+        parts = ['<!DOCTYPE html>\n<html><head><meta charset="utf-8"><title>parity</title></head><body>\n']
+        length = len(parts[0])
+        while length < size:
+            chunk = ' '.join(rng.choice(WORDS) for _ in range(rng.randrange(3, 12)))
+            chunk = f"<p>{chunk} {corpus_link(rng)}</p>\n"
+            parts.append(chunk)
+            length += len(chunk.encode('utf-8'))
+        parts.append('</body></html>\n')
+        out.append((f"page-{n}.html", ''.join(parts).encode('utf-8')))
+    return out
+
+
+def load_corpus(path):
+    out = []
+    for name in sorted(os.listdir(path)):
+        if name.lower().endswith(('.html', '.htm')):
+            with open(os.path.join(path, name), 'rb') as f:
+                out.append((name, f.read()))
+    return out
+
+
+def parse_size(s):
+    m = re.fullmatch(r'(\d+)([kKmM]?)', s)
+    if not m:
+        raise argparse.ArgumentTypeError(f"invalid size: {s}")
+    return int(m.group(1)) * {'': 1, 'k': 1024, 'm': 1024 * 1024}[m.group(2).lower()]
+
+
+# --------- Local page server ---------
+class PageServer:
+    def __init__(self, pages):
+        self.pages = dict(pages)
+        handler = self._handler()
+        ThreadingHTTPServer.request_queue_size = 128
+        self.httpd = ThreadingHTTPServer(('127.0.0.1', 0), handler)
+        self.port = self.httpd.server_address[1]
+        self.thread = threading.Thread(target=self.httpd.serve_forever, daemon=True)
+
+    def _handler(self):
+        pages = self.pages
+
+        class Handler(BaseHTTPRequestHandler):
+            def do_GET(self):
+                body = pages.get(self.path.lstrip('/'))
+                if body is None:
+                    self.send_error(404)
+                    return
+                self.send_response(200)
+                self.send_header('Content-Type', 'text/html; charset=utf-8')
+                self.send_header('Content-Length', str(len(body)))
+                self.end_headers()
+                self.wfile.write(body)
+
+            def log_message(self, fmt, *args):
+                pass
+
+        return Handler
+
+    def url(self, name):
+        return f"http://127.0.0.1:{self.port}/{name}"
+
+    def __enter__(self):
+        self.thread.start()
+        return self
+
+    def __exit__(self, *exc):
+        self.httpd.shutdown()
+        self.httpd.server_close()
+
+
+# --------- Edition builds ---------
+def build_c(work):
+    exe = os.path.join(work, 'kno-url-c')
+    cc = os.environ.get('CC', 'cc')
+    if not shutil.which(cc):
+        return None, f"{cc} not found"
+    r = subprocess.run([cc, '-O2', '-pthread', '-o', exe, os.path.join(RED_TEAM, 'kno-url.c'), '-ldl'],
+                       capture_output=True, text=True)
+    if r.returncode != 0:
+        return None, r.stderr.strip().splitlines()[-1] if r.stderr.strip() else 'build failed'
+    return [exe], None
+
+
+def build_go(work):
+    if not shutil.which('go'):
+        return None, 'go not found'
+    exe = os.path.join(work, 'kno-url-go')
+    r = subprocess.run(['go', 'build', '-o', exe, os.path.join(RED_TEAM, 'kno-url.go')],
+                       capture_output=True, text=True, cwd=work)
+    if r.returncode != 0:
+        return None, r.stderr.strip().splitlines()[-1] if r.stderr.strip() else 'build failed'
+    return [exe], None
+
+
+def build_python(work, accelerated):
+    d = os.path.join(work, 'py-c' if accelerated else 'py')
+    os.makedirs(d, exist_ok=True)
+    shutil.copy(os.path.join(HERE, 'kno-url.py'), d)
+    if accelerated:
+        cc = os.environ.get('CC', 'cc')
+        so = os.path.join(d, '_knourl' + (sysconfig.get_config_var('EXT_SUFFIX') or '.so'))
+        r = subprocess.run([cc, '-O2', '-shared', '-fPIC', '-I' + sysconfig.get_paths()['include'],
+                            '-o', so, os.path.join(HERE, '_knourl.c')], capture_output=True, text=True)
+        if r.returncode != 0:
+            return None, '_knourl build failed'
+    return [sys.executable, os.path.join(d, 'kno-url.py')], None
+
+
+def build_edition(name, work):
+    if name == 'c':
+        return build_c(work)
+    if name == 'go':
+        return build_go(work)
+    if name == 'python':
+        return build_python(work, False)
+    if name == 'python+_knourl':
+        return build_python(work, True)
+    return None, 'unknown edition'
+
+
+# --------- Running and parsing ---------
+def run_session(cmd, lines, work):
+    """Run one REPL session; returns (stdout text, wall seconds, peak RSS bytes)."""
+    in_path = os.path.join(work, 'stdin.txt')
+    out_path = os.path.join(work, 'stdout.txt')
+    with open(in_path, 'w', encoding='utf-8') as f:
+        f.write(''.join(line + '\n' for line in lines))
+    with open(in_path, 'rb') as fin, open(out_path, 'wb') as fout:
+        t0 = time.perf_counter()
+        p = subprocess.Popen(cmd, stdin=fin, stdout=fout, stderr=subprocess.DEVNULL, cwd=work)
+        _, status, usage = os.wait4(p.pid, 0)
+        wall = time.perf_counter() - t0
+        p.returncode = os.waitstatus_to_exitcode(status)
+    with open(out_path, 'rb') as f:
+        text = f.read().decode('utf-8', errors='replace')
+    rss = usage.ru_maxrss * (1 if sys.platform == 'darwin' else 1024)
+    return text, wall, rss
+
+
+FETCH_RE = re.compile(r'\[\*\] Fetching HTML from (\S+)')
+
+
+def parse_session(text):
+    """Map each fetched URL (first occurrence) to {category: [urls in printed order]}."""
+    text = text.replace('Main URL: ', '\n')
+    pages = {}
+    current = None
+    cat = None
+    for line in text.splitlines():
+        m = FETCH_RE.search(line)
+        if m:
+            key = m.group(1)
+            current = None if key in pages else pages.setdefault(key, {c: [] for c in CATEGORIES})
+            cat = None
+            continue
+        if current is None:
+            continue
+        if line in CATEGORIES:
+            cat = line
+        elif not line.strip():
+            cat = None
+        elif cat and not line.startswith(('[', ' ')):
+            current[cat].append(line)
+    return pages
+
+
+# --------- Report ---------
+def fmt_bytes(n):
+    return f"{n / (1024 * 1024):.1f} MiB"
+
+
+def diff_report(ref_name, ref, name, got, examples):
+    """Per-category diff of got against ref (both {page: {cat: [urls]}})."""
+    only_ref = {c: set() for c in CATEGORIES}
+    only_got = {c: set() for c in CATEGORIES}
+    moved = {}
+    for page in ref:
+        r = ref[page]
+        g = got.get(page, {c: [] for c in CATEGORIES})
+        r_cat = {u: c for c in CATEGORIES for u in r[c]}
+        g_cat = {u: c for c in CATEGORIES for u in g[c]}
+        for u, c in r_cat.items():
+            if u not in g_cat:
+                only_ref[c].add(u)
+            elif g_cat[u] != c:
+                moved.setdefault((c, g_cat[u]), set()).add(u)
+        for u, c in g_cat.items():
+            if u not in r_cat:
+                only_got[c].add(u)
+
+    total = sum(len(s) for s in only_ref.values()) + sum(len(s) for s in only_got.values()) + \
+        sum(len(s) for s in moved.values())
+    print(f"\n{name} vs {ref_name}: {'identical' if total == 0 else f'{total} differing URLs'}")
+    for c in CATEGORIES:
+        if not only_ref[c] and not only_got[c]:
+            continue
+        print(f"  {c}: {len(only_got[c])} only in {name}, {len(only_ref[c])} only in {ref_name}")
+        for u in sorted(only_got[c])[:examples]:
+            print(f"      + {u}")
+        for u in sorted(only_ref[c])[:examples]:
+            print(f"      - {u}")
+    for (rc, gc), urls in sorted(moved.items(), key=lambda kv: -len(kv[1])):
+        print(f"  {len(urls)} URLs in {rc} for {ref_name} but {gc} for {name}")
+        for u in sorted(urls)[:examples]:
+            print(f"      ~ {u}")
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Cross-edition parity and performance harness for kno-url.")
+    ap.add_argument('--pages', type=int, default=20, help="generated pages (default 20)")
+    ap.add_argument('--size', type=parse_size, default=parse_size('256k'), help="bytes per generated page (default 256k)")
+    ap.add_argument('--seed', type=int, default=1)
+    ap.add_argument('--corpus', help="directory of .html files to use instead of a generated corpus")
+    ap.add_argument('--repeat', type=int, default=3, help="times each page is fed per timed session (default 3)")
+    ap.add_argument('--editions', default=','.join(ALL_EDITIONS))
+    ap.add_argument('--reference', default='python', help="edition the others are diffed against (default python)")
+    ap.add_argument('--examples', type=int, default=3, help="example URLs printed per difference (default 3)")
+    ap.add_argument('--keep', action='store_true', help="keep the work directory")
+    opts = ap.parse_args()
+
+    editions = [e.strip() for e in opts.editions.split(',') if e.strip()]
+    for e in editions:
+        if e not in ALL_EDITIONS:
+            print(f"Error: unknown edition {e} (choose from {', '.join(ALL_EDITIONS)})")
+            return 1
+
+    corpus = load_corpus(opts.corpus) if opts.corpus else build_corpus(opts.pages, opts.size, opts.seed)
+    if not corpus:
+        print("[-] Empty corpus.")
+        return 1
+    corpus_bytes = sum(len(b) for _, b in corpus)
+    src = opts.corpus or f"seed {opts.seed}"
+    print(f"[*] corpus: {len(corpus)} pages, {fmt_bytes(corpus_bytes)} ({src}), repeat {opts.repeat}")
+
+    work = tempfile.mkdtemp(prefix='kno-url-parity-')
+    results = {}
+    rows = []
+    try:
+        with PageServer(corpus) as srv:
+            urls = [srv.url(name) for name, _ in corpus]
+            for e in editions:
+                cmd, err = build_edition(e, work)
+                if cmd is None:
+                    print(f"[!] {e}: skipped ({err})")
+                    continue
+                # A throwaway session first so later ones start with warm caches.
+                run_session(cmd, [], work)
+                _, startup, _ = run_session(cmd, [], work)
+                text, wall, rss = run_session(cmd, urls * opts.repeat, work)
+                results[e] = parse_session(text)
+                work_s = max(wall - startup, 1e-9)
+                pages_done = len(results[e])
+                if pages_done < len(corpus):
+                    print(f"[!] {e}: only {pages_done} of {len(corpus)} pages produced output")
+                printed = sum(len(v) for p in results[e].values() for v in p.values())
+                unique = sum(len(set(v)) for p in results[e].values() for v in p.values())
+                rows.append((e, startup * 1000, wall * 1000, corpus_bytes * opts.repeat / work_s / (1024 * 1024),
+                             len(corpus) * opts.repeat / work_s, rss, printed, unique))
+    finally:
+        if opts.keep:
+            print(f"[*] work directory kept: {work}")
+        else:
+            shutil.rmtree(work, ignore_errors=True)
+
+    if not rows:
+        print("[-] No edition could be run.")
+        return 1
+
+    print(f"\n{'edition':<16}{'startup ms':>11}{'session ms':>12}{'MiB/s':>9}{'pages/s':>9}"
+          f"{'peak RSS':>11}{'URLs':>8}{'unique':>8}")
+    for e, st, wall, mbs, pps, rss, printed, unique in rows:
+        print(f"{e:<16}{st:>11.1f}{wall:>12.1f}{mbs:>9.1f}{pps:>9.1f}{fmt_bytes(rss):>11}{printed:>8}{unique:>8}")
+    print("[*] MiB/s and pages/s exclude start-up; URLs counts the first pass over each page "
+          "(URLs > unique means the edition prints duplicates).")
+
+    ref = opts.reference if opts.reference in results else next(iter(results))
+    if ref != opts.reference:
+        print(f"[!] reference {opts.reference} did not run; diffing against {ref}")
+    for e in results:
+        if e != ref:
+            diff_report(ref, results[ref], e, results[e], opts.examples)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,388 @@
+/*
+ * Kusanagi Night Ops: URL Scrapper (C Edition) - hot path microbenchmarks
+ *
+ * Builds kno-url.c without its main() and times the per-page hot paths over
+ * a generated HTML corpus:
+ *
+ *   cc -O2 -pthread -o kno-url-bench kno-url-bench.c -lcurl
+ *   ./kno-url-bench [--size 4m] [--density 20] [--escapes 0.1] [--seed 1]
+ *                   [--min-time 500] [--rules file] [--bin ./kno-url-c] [name ...]
+ *
+ * Same seed and sizes give the same corpus, so numbers are comparable
+ * between builds. Allocation counts come from kno-url.c's own allocator
+ * accounting (KNO_ALLOC_STATS), so libc and libcurl internals are not
+ * included. With --bin, "startup" also times one-shot offline runs of that
+ * binary (fork + exec + parse a 4 KiB page) to track cold start.
+ */
+#define KNO_ALLOC_STATS
+#define KNO_URL_NO_MAIN
+#define KNO_CURL_LINKED
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#endif
+#include "kno-url.c"
+#if defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+#include <fcntl.h>
+#include <sys/wait.h>
+
+/* ---------- Synthetic corpus ---------- */
+typedef struct {
+    size_t size;        /* bytes of HTML */
+    double density;     /* URLs per KiB */
+    double escapes;     /* fraction of URLs written JSON-escaped or with &amp; */
+    uint64_t seed;
+} CorpusSpec;
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} Buf;
+
+static uint64_t g_rng;
+
+static uint64_t rng_next(void) {
+    uint64_t z = (g_rng += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static double rng_unit(void) {
+    return (double)(rng_next() >> 11) / 9007199254740992.0;
+}
+
+#define PICK(arr) (arr[rng_next() % (sizeof(arr) / sizeof(arr[0]))])
+
+static void buf_put(Buf *b, const char *s, size_t n) {
+    if (b->len + n + 1 > b->cap) {
+        size_t nc = b->cap ? b->cap * 2 : 4096;
+        while (nc < b->len + n + 1) nc *= 2;
+        char *d = (char *)realloc(b->data, nc);
+        if (!d) {
+            fprintf(stderr, "[-] Out of memory building corpus\n");
+            exit(1);
+        }
+        b->data = d;
+        b->cap = nc;
+    }
+    memcpy(b->data + b->len, s, n);
+    b->len += n;
+    b->data[b->len] = '\0';
+}
+
+static void buf_puts(Buf *b, const char *s) {
+    buf_put(b, s, strlen(s));
+}
+
+static const char *k_hosts[] = {
+    "example.com", "cdn.example.com", "static.example.net", "api.example.org",
+    "img.cdn-host.io", "assets.shop.example", "docs.example.dev", "media.example.tv",
+};
+static const char *k_dirs[] = {
+    "/", "/assets/", "/static/js/", "/img/", "/api/v1/", "/api/v2/users/", "/docs/",
+    "/media/video/", "/blog/2024/", "/graphql", "/dl/",
+};
+static const char *k_names[] = {
+    "app", "main", "vendor", "logo", "hero", "index", "report", "intro", "style", "data", "feed",
+};
+static const char *k_exts[] = {
+    ".js", ".mjs", ".css", ".png", ".jpg", ".webp", ".svg", ".mp4", ".json", ".pdf",
+    ".html", ".php", ".bundle.js", ".chunk.js", "", ".xml", ".woff2",
+};
+static const char *k_words[] = {
+    "night", "ops", "the", "scraper", "of", "link", "page", "content", "menu", "footer",
+    "header", "section", "quick", "brown", "fox", "lorem", "ipsum",
+};
+static const char *k_tags[] = {
+    "<div class=\"row\">", "</div>", "<p>", "</p>", "<span>", "</span>", "<li>", "</li>",
+};
+
+/* One URL in the form the generator's escape mode asks for. */
+static void corpus_url(Buf *b, int escaped) {
+    char u[256];
+    const char *scheme = (rng_next() % 4) ? "https://" : "http://";
+    const char *dir = PICK(k_dirs);
+    int n;
+    if (strcmp(dir, "/graphql") == 0) {
+        n = snprintf(u, sizeof(u), "%s%s%s?op=q%u", scheme, PICK(k_hosts), dir, (unsigned)(rng_next() % 1000));
+    } else {
+        n = snprintf(u, sizeof(u), "%s%s%s%s-%u%s", scheme, PICK(k_hosts), dir, PICK(k_names),
+                     (unsigned)(rng_next() % 10000), PICK(k_exts));
+    }
+    if (n < 0) return;
+    if (!escaped) {
+        buf_puts(b, u);
+        if (rng_next() % 3 == 0) buf_puts(b, "?v=3");
+        return;
+    }
+    if (rng_next() % 2) {
+        /* JSON string in an inline script: "https:\/\/host\/path" */
+        for (const char *p = u; *p; p++) {
+            if (*p == '/') buf_put(b, "\\/", 2);
+            else buf_put(b, p, 1);
+        }
+    } else {
+        buf_puts(b, u);
+        buf_puts(b, "?a=1&amp;b=2&amp;c=3");
+    }
+}
+
+static char *corpus_build(const CorpusSpec *cs, size_t *len) {
+    Buf b = { NULL, 0, 0 };
+    double url_every = cs->density > 0 ? 1024.0 / cs->density : 1e18;
+    double next_url = rng_unit() * url_every;
+
+    g_rng = cs->seed;
+    buf_puts(&b, "<!DOCTYPE html>\n<html><head><title>bench</title></head><body>\n");
+    while (b.len < cs->size) {
+        if ((double)b.len >= next_url) {
+            int escaped = rng_unit() < cs->escapes;
+            switch (rng_next() % 4) {
+            case 0: buf_puts(&b, "<a href=\""); corpus_url(&b, escaped); buf_puts(&b, "\">link</a>"); break;
+            case 1: buf_puts(&b, "<script src=\""); corpus_url(&b, escaped); buf_puts(&b, "\"></script>"); break;
+            case 2: buf_puts(&b, "<img src='"); corpus_url(&b, escaped); buf_puts(&b, "'>"); break;
+            default: buf_puts(&b, "<script>var u=\""); corpus_url(&b, escaped); buf_puts(&b, "\";</script>"); break;
+            }
+            next_url += url_every * (0.5 + rng_unit());
+        } else if (rng_next() % 8 == 0) {
+            buf_puts(&b, PICK(k_tags));
+        } else {
+            buf_puts(&b, PICK(k_words));
+            buf_put(&b, (rng_next() % 12) ? " " : "\n", 1);
+        }
+    }
+    buf_puts(&b, "\n</body></html>\n");
+    *len = b.len;
+    return b.data;
+}
+
+/* ---------- Benchmarks ---------- */
+typedef struct {
+    const char *html;
+    size_t html_len;
+    StrList urls;
+    size_t url_bytes;
+    Needle needle;
+    HtmlOptions opts;
+    volatile size_t sink;
+} BenchCtx;
+
+static void bench_extract(BenchCtx *c) {
+    StrList urls; sl_init(&urls);
+    extract_urls_from_html(c->html, c->html_len, &urls);
+    c->sink += urls.count;
+    sl_free(&urls);
+}
+
+static void bench_categorize(BenchCtx *c) {
+    size_t acc = 0;
+    for (size_t i = 0; i < c->urls.count; i++) acc += (size_t)categorize_url(c->urls.items[i]);
+    c->sink += acc;
+}
+
+static void bench_search(BenchCtx *c) {
+    size_t acc = 0;
+    for (size_t i = 0; i < c->urls.count; i++) {
+        const char *u = c->urls.items[i];
+        acc += (size_t)needle_match(&c->needle, u, strlen(u));
+    }
+    c->sink += acc;
+}
+
+static void bench_get_ext(BenchCtx *c) {
+    size_t acc = 0;
+    for (size_t i = 0; i < c->urls.count; i++) acc += strlen(get_ext(c->urls.items[i]));
+    c->sink += acc;
+}
+
+static void bench_sort(BenchCtx *c) {
+    UrlWithExt *arr = (UrlWithExt *)kno_malloc(c->urls.count * sizeof(UrlWithExt));
+    if (!arr) return;
+    for (size_t i = 0; i < c->urls.count; i++) {
+        arr[i].url = c->urls.items[i];
+        arr[i].ext = get_ext(c->urls.items[i]);
+    }
+    qsort(arr, c->urls.count, sizeof(UrlWithExt), cmp_uwe);
+    if (c->urls.count) c->sink += (size_t)arr[0].url[0];
+    kno_free(arr);
+}
+
+static void bench_render(BenchCtx *c) {
+    RunStats rs;
+    StrList out; sl_init(&out);
+    memset(&rs, 0, sizeof(rs));
+    render_page(c->html, c->html_len, &c->opts, &rs, NULL, &out);
+    c->sink += out.count;
+    sl_free(&out);
+}
+
+typedef struct {
+    const char *name;
+    void (*fn)(BenchCtx *);
+    int per_url;    /* ns/op is per URL instead of per page */
+} BenchDef;
+
+static const BenchDef k_benches[] = {
+    { "extract",    bench_extract,    0 },
+    { "categorize", bench_categorize, 1 },
+    { "search",     bench_search,     1 },
+    { "get_ext",    bench_get_ext,    1 },
+    { "sort",       bench_sort,       0 },
+    { "render",     bench_render,     0 },
+};
+
+static void mem_totals(size_t *allocs, size_t *bytes) {
+    *allocs = *bytes = 0;
+    for (int ph = 0; ph < MEM_PHASE_COUNT; ph++) {
+        *allocs += atomic_load(&g_mem[ph].allocs);
+        *bytes += atomic_load(&g_mem[ph].bytes);
+    }
+}
+
+static void bench_run(const BenchDef *b, BenchCtx *c, double min_ms) {
+    size_t iters = 0;
+    size_t allocs0, bytes0, allocs1, bytes1;
+    double start, elapsed;
+
+    b->fn(c);   /* warm-up */
+    mem_totals(&allocs0, &bytes0);
+    start = mono_ms();
+    do {
+        b->fn(c);
+        iters++;
+        elapsed = mono_ms() - start;
+    } while (elapsed < min_ms);
+    mem_totals(&allocs1, &bytes1);
+
+    double ops = (double)iters * (b->per_url ? (double)c->urls.count : 1.0);
+    double bytes = (double)iters * (b->per_url ? (double)c->url_bytes : (double)c->html_len);
+    printf("%-12s %10zu %12.1f %10.1f %12.2f %12.1f\n", b->name, iters,
+           ops > 0 ? elapsed * 1e6 / ops : 0.0,
+           elapsed > 0 ? bytes / (elapsed / 1000.0) / (1024.0 * 1024.0) : 0.0,
+           ops > 0 ? (double)(allocs1 - allocs0) / ops : 0.0,
+           ops > 0 ? (double)(bytes1 - bytes0) / ops : 0.0);
+}
+
+/* Cold start of the real binary: `bin --input page -s` with output discarded. */
+static void bench_startup(const char *bin, const char *html, size_t len, double min_ms) {
+    char path[] = "/tmp/kno-url-bench-XXXXXX";
+    int fd = mkstemp(path);
+    size_t n = len < 4096 ? len : 4096;
+    Histogram h;
+    size_t iters = 0;
+    double start, elapsed;
+
+    if (fd < 0 || write(fd, html, n) != (ssize_t)n) {
+        fprintf(stderr, "[-] Could not write startup page\n");
+        if (fd >= 0) close(fd);
+        return;
+    }
+    close(fd);
+    memset(&h, 0, sizeof(h));
+    start = mono_ms();
+    do {
+        double t0 = mono_ms();
+        pid_t pid = fork();
+        if (pid == 0) {
+            int devnull = open("/dev/null", O_WRONLY);
+            if (devnull >= 0) {
+                dup2(devnull, STDOUT_FILENO);
+                dup2(devnull, STDERR_FILENO);
+            }
+            execl(bin, bin, "--input", path, "-s", (char *)NULL);
+            _exit(127);
+        }
+        int status = 0;
+        if (pid < 0 || waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            fprintf(stderr, "[-] %s --input %s -s failed\n", bin, path);
+            unlink(path);
+            return;
+        }
+        hist_record(&h, (uint64_t)((mono_ms() - t0) * 1000.0));
+        iters++;
+        elapsed = mono_ms() - start;
+    } while (elapsed < min_ms);
+    unlink(path);
+
+    printf("%-12s %10zu %12.1f %10.1f %12s %12s\n", "startup", iters, elapsed * 1e6 / (double)iters,
+           (double)n * (double)iters / (elapsed / 1000.0) / (1024.0 * 1024.0), "-", "-");
+    printf("[*] startup p50 %llu us, p99 %llu us, max %llu us (%s, offline one-shot)\n",
+           (unsigned long long)hist_percentile(&h, 0.50), (unsigned long long)hist_percentile(&h, 0.99),
+           (unsigned long long)h.max, bin);
+}
+
+static size_t parse_size(const char *s) {
+    char *end;
+    double v = strtod(s, &end);
+    if (*end == 'k' || *end == 'K') v *= 1024.0;
+    else if (*end == 'm' || *end == 'M') v *= 1024.0 * 1024.0;
+    return v > 0 ? (size_t)v : 0;
+}
+
+int main(int argc, char **argv) {
+    CorpusSpec cs = { 4u * 1024u * 1024u, 20.0, 0.1, 1 };
+    double min_ms = 500.0;
+    const char *rules_path = NULL;
+    const char *bin = NULL;
+    const char *only[16];
+    int nonly = 0;
+    BenchCtx ctx;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) cs.size = parse_size(argv[++i]);
+        else if (strcmp(argv[i], "--density") == 0 && i + 1 < argc) cs.density = atof(argv[++i]);
+        else if (strcmp(argv[i], "--escapes") == 0 && i + 1 < argc) cs.escapes = atof(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) cs.seed = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) min_ms = atof(argv[++i]);
+        else if (strcmp(argv[i], "--rules") == 0 && i + 1 < argc) rules_path = argv[++i];
+        else if (strcmp(argv[i], "--bin") == 0 && i + 1 < argc) bin = argv[++i];
+        else if (argv[i][0] != '-' && nonly < 16) only[nonly++] = argv[i];
+        else {
+            fprintf(stderr, "Usage: %s [--size 4m] [--density 20] [--escapes 0.1] [--seed 1] "
+                            "[--min-time 500] [--rules file] [--bin ./kno-url-c] [name ...]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (cs.size == 0 || cs.escapes < 0.0 || cs.escapes > 1.0) {
+        fprintf(stderr, "Error: --size must be positive and --escapes within 0..1.\n");
+        return 2;
+    }
+    if (!category_rules_init(rules_path)) return 1;
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.html = corpus_build(&cs, &ctx.html_len);
+    sl_init(&ctx.urls);
+    extract_urls_from_html(ctx.html, ctx.html_len, &ctx.urls);
+    for (size_t i = 0; i < ctx.urls.count; i++) ctx.url_bytes += strlen(ctx.urls.items[i]);
+    if (!needle_init(&ctx.needle, "api")) return 1;
+
+    printf("[*] corpus: %.2f MiB, %zu URLs, seed %llu (density %.1f/KiB, escapes %.2f)\n",
+           (double)ctx.html_len / (1024.0 * 1024.0), ctx.urls.count, (unsigned long long)cs.seed,
+           cs.density, cs.escapes);
+    printf("%-12s %10s %12s %10s %12s %12s\n", "benchmark", "iters", "ns/op", "MiB/s", "allocs/op", "bytes/op");
+    for (size_t b = 0; b < sizeof(k_benches) / sizeof(k_benches[0]); b++) {
+        int run = nonly == 0;
+        for (int i = 0; i < nonly; i++) {
+            if (strcmp(only[i], k_benches[b].name) == 0) run = 1;
+        }
+        if (run) bench_run(&k_benches[b], &ctx, min_ms);
+    }
+    if (bin) {
+        int run = nonly == 0;
+        for (int i = 0; i < nonly; i++) {
+            if (strcmp(only[i], "startup") == 0) run = 1;
+        }
+        if (run) bench_startup(bin, ctx.html, ctx.html_len, min_ms);
+    }
+    printf("[*] categorize/search/get_ext are per URL; extract/sort/render are per page.\n");
+
+    needle_free(&ctx.needle);
+    sl_free(&ctx.urls);
+    free((char *)ctx.html);
+    return 0;
+}
@@ -0,0 +1,435 @@
+/*
+ * Kusanagi Night Ops: URL Scrapper (C Edition) - end-to-end load benchmark
+ *
+ * Forks a small HTTP/1.1 server on 127.0.0.1 that serves a generated site
+ * (pages linking to each other plus asset URLs), then drives the scraper's
+ * own fetch + parse code against it:
+ *
+ *   cc -O2 -pthread -o kno-url-loadbench kno-url-loadbench.c -lcurl -lz
+ *   ./kno-url-loadbench [--pages 200] [--page-size 64k] [--links 20]
+ *                       [--latency 0] [--jitter 0] [--no-gzip] [--no-keepalive]
+ *                       [--requests N] [--concurrency 8] [--seed 1]
+ *                       [--modes single,batch]
+ *
+ * For each mode it reports requests/s, fetch latency p50/p99, parse p99,
+ * client CPU time and the client's peak RSS. Nothing leaves the loopback
+ * interface. POSIX only.
+ */
+#define KNO_URL_NO_MAIN
+#define KNO_CURL_LINKED
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#endif
+#include "kno-url.c"
+#if defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <zlib.h>
+
+/* ---------- Generated site ---------- */
+typedef struct {
+    size_t pages;
+    size_t page_size;
+    size_t links;           /* out-links to other pages per page */
+    long latency_ms;        /* added before every response */
+    long jitter_ms;         /* uniform extra 0..jitter */
+    int gzip;
+    int keepalive;
+    uint64_t seed;
+} SiteSpec;
+
+typedef struct {
+    char *body;
+    size_t len;
+    unsigned char *gz;
+    size_t gz_len;
+} SitePage;
+
+static SitePage *g_site = NULL;
+static SiteSpec g_spec;
+static uint64_t g_lb_rng;
+
+static uint64_t lb_rand(void) {
+    uint64_t z = (g_lb_rng += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static const char *k_asset_exts[] = { ".js", ".css", ".png", ".jpg", ".json", ".pdf", ".mp4", ".svg" };
+
+static int site_gzip(SitePage *pg) {
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (deflateInit2(&zs, 6, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) return 0;
+    size_t cap = deflateBound(&zs, (uLong)pg->len);
+    pg->gz = (unsigned char *)malloc(cap);
+    if (!pg->gz) {
+        deflateEnd(&zs);
+        return 0;
+    }
+    zs.next_in = (Bytef *)pg->body;
+    zs.avail_in = (uInt)pg->len;
+    zs.next_out = pg->gz;
+    zs.avail_out = (uInt)cap;
+    int rc = deflate(&zs, Z_FINISH);
+    pg->gz_len = zs.total_out;
+    deflateEnd(&zs);
+    return rc == Z_STREAM_END;
+}
+
+static int site_build(int port) {
+    g_site = (SitePage *)calloc(g_spec.pages, sizeof(SitePage));
+    if (!g_site) return 0;
+    g_lb_rng = g_spec.seed;
+    for (size_t i = 0; i < g_spec.pages; i++) {
+        size_t cap = g_spec.page_size + 512;
+        char *b = (char *)malloc(cap);
+        size_t n = 0;
+        if (!b) return 0;
+        n += (size_t)snprintf(b + n, cap - n, "<!DOCTYPE html>\n<html><head><title>page %zu</title></head><body>\n", i);
+        for (size_t l = 0; l < g_spec.links && n + 256 < cap; l++) {
+            n += (size_t)snprintf(b + n, cap - n, "<a href=\"http://127.0.0.1:%d/p/%llu.html\">next</a>\n",
+                                  port, (unsigned long long)(lb_rand() % g_spec.pages));
+        }
+        while (n + 256 < g_spec.page_size) {
+            if (lb_rand() % 6 == 0) {
+                n += (size_t)snprintf(b + n, cap - n, "<img src=\"http://127.0.0.1:%d/assets/a%llu%s\">\n", port,
+                                      (unsigned long long)(lb_rand() % 100000),
+                                      k_asset_exts[lb_rand() % (sizeof(k_asset_exts) / sizeof(k_asset_exts[0]))]);
+            } else {
+                n += (size_t)snprintf(b + n, cap - n, "<p>night ops load bench filler text %llu</p>\n",
+                                      (unsigned long long)lb_rand());
+            }
+        }
+        n += (size_t)snprintf(b + n, cap - n, "</body></html>\n");
+        g_site[i].body = b;
+        g_site[i].len = n;
+        if (g_spec.gzip && !site_gzip(&g_site[i])) return 0;
+    }
+    return 1;
+}
+
+/* ---------- Loopback HTTP/1.1 server ---------- */
+static int send_all(int fd, const void *data, size_t len) {
+    const char *p = (const char *)data;
+    while (len > 0) {
+        ssize_t w = send(fd, p, len, MSG_NOSIGNAL);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return 0;
+        p += w;
+        len -= (size_t)w;
+    }
+    return 1;
+}
+
+static void *server_conn(void *arg) {
+    int fd = (int)(intptr_t)arg;
+    char req[8192];
+    size_t have = 0;
+    uint64_t rng = g_spec.seed ^ (uint64_t)fd;
+
+    req[0] = '\0';
+    for (;;) {
+        char *end = NULL;
+        while (!(end = strstr(req, "\r\n\r\n"))) {
+            if (have + 1 >= sizeof(req)) goto done;
+            ssize_t r = recv(fd, req + have, sizeof(req) - 1 - have, 0);
+            if (r <= 0) goto done;
+            have += (size_t)r;
+            req[have] = '\0';
+        }
+        size_t req_len = (size_t)(end + 4 - req);
+
+        unsigned long idx = 0;
+        int found = sscanf(req, "GET /p/%lu.html", &idx) == 1 && idx < g_spec.pages;
+        int want_gzip = g_spec.gzip && strstr(req, "gzip") != NULL;
+        int close_after = !g_spec.keepalive || strstr(req, "Connection: close") != NULL;
+
+        if (g_spec.latency_ms > 0 || g_spec.jitter_ms > 0) {
+            rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+            long ms = g_spec.latency_ms + (g_spec.jitter_ms > 0 ? (long)((rng >> 33) % (uint64_t)(g_spec.jitter_ms + 1)) : 0);
+            struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+            nanosleep(&ts, NULL);
+        }
+
+        char head[256];
+        const void *body = "not found\n";
+        size_t blen = 10;
+        if (found) {
+            body = want_gzip ? (const void *)g_site[idx].gz : (const void *)g_site[idx].body;
+            blen = want_gzip ? g_site[idx].gz_len : g_site[idx].len;
+        }
+        int hl = snprintf(head, sizeof(head),
+                          "HTTP/1.1 %s\r\nContent-Type: text/html\r\nContent-Length: %zu\r\n%s%s\r\n",
+                          found ? "200 OK" : "404 Not Found", blen,
+                          found && want_gzip ? "Content-Encoding: gzip\r\n" : "",
+                          close_after ? "Connection: close\r\n" : "Connection: keep-alive\r\n");
+        if (!send_all(fd, head, (size_t)hl) || !send_all(fd, body, blen) || close_after) break;
+
+        memmove(req, req + req_len, have - req_len);
+        have -= req_len;
+        req[have] = '\0';
+    }
+done:
+    close(fd);
+    return NULL;
+}
+
+static void server_run(int lfd) {
+    for (;;) {
+        int cfd = accept(lfd, NULL, NULL);
+        if (cfd < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        int one = 1;
+        pthread_t t;
+        /* Head and body go out in two sends; without this, keep-alive responses stall on delayed ACKs. */
+        setsockopt(cfd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (pthread_create(&t, NULL, server_conn, (void *)(intptr_t)cfd) == 0) pthread_detach(t);
+        else close(cfd);
+    }
+}
+
+/* Bind, fork and wait until the child has built the site. Returns the child pid or -1. */
+static pid_t server_start(int *port) {
+    struct sockaddr_in sin;
+    socklen_t sl = sizeof(sin);
+    int ready[2];
+    int one = 1;
+    int lfd = socket(AF_INET, SOCK_STREAM, 0);
+
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (lfd < 0) return -1;
+    setsockopt(lfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(lfd, (struct sockaddr *)&sin, sizeof(sin)) != 0 || listen(lfd, 512) != 0 ||
+        getsockname(lfd, (struct sockaddr *)&sin, &sl) != 0 || pipe(ready) != 0) {
+        close(lfd);
+        return -1;
+    }
+    *port = ntohs(sin.sin_port);
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        char ok;
+        close(ready[0]);
+        ok = site_build(*port) ? 1 : 0;
+        if (write(ready[1], &ok, 1) != 1 || !ok) _exit(1);
+        close(ready[1]);
+        server_run(lfd);
+        _exit(0);
+    }
+    close(lfd);
+    close(ready[1]);
+    char ok = 0;
+    if (pid < 0 || read(ready[0], &ok, 1) != 1 || !ok) {
+        if (pid > 0) {
+            kill(pid, SIGTERM);
+            waitpid(pid, NULL, 0);
+        }
+        pid = -1;
+    }
+    close(ready[0]);
+    return pid;
+}
+
+/* ---------- Driver ---------- */
+typedef struct {
+    struct rusage ru;
+    double wall;
+} Mark;
+
+static void mark_now(Mark *m) {
+    getrusage(RUSAGE_SELF, &m->ru);
+    m->wall = mono_ms();
+}
+
+static double tv_ms(struct timeval tv) {
+    return (double)tv.tv_sec * 1000.0 + (double)tv.tv_usec / 1000.0;
+}
+
+static void lat_merge_metric(int metric, Histogram *out) {
+    memset(out, 0, sizeof(*out));
+    for (LatRecorder *r = atomic_load(&g_lat_recorders); r; r = r->next) {
+        for (size_t i = 0; i < r->count; i++) hist_merge(out, &r->hosts[i].h[metric]);
+    }
+}
+
+static void report(const char *mode, size_t requests, const Mark *a, const Mark *b) {
+    Histogram total, parse;
+    double wall = b->wall - a->wall;
+    double cpu = tv_ms(b->ru.ru_utime) - tv_ms(a->ru.ru_utime) + tv_ms(b->ru.ru_stime) - tv_ms(a->ru.ru_stime);
+
+    lat_merge_metric(LAT_TOTAL, &total);
+    lat_merge_metric(LAT_PARSE, &parse);
+    printf("%-8s %8zu %10.1f %10.2f %10.2f %10.2f %10.1f %10.1f\n", mode, requests,
+           wall > 0 ? (double)requests * 1000.0 / wall : 0.0,
+           (double)hist_percentile(&total, 0.50) / 1000.0,
+           (double)hist_percentile(&total, 0.99) / 1000.0,
+           (double)hist_percentile(&parse, 0.99) / 1000.0,
+           cpu, (double)b->ru.ru_maxrss / 1024.0);
+}
+
+/* One scraper command per page, like typing each URL at the prompt. */
+static void run_single(int port, size_t requests) {
+    HtmlOptions o;
+    RunStats rs;
+    Mark a, b;
+
+    memset(&o, 0, sizeof(o));
+    memset(&rs, 0, sizeof(rs));
+    lat_reset();
+    mark_now(&a);
+    for (size_t i = 0; i < requests; i++) {
+        char url[128];
+        FetchStats fs;
+        StrList out; sl_init(&out);
+        snprintf(url, sizeof(url), "http://127.0.0.1:%d/p/%zu.html", port, i % g_spec.pages);
+        memset(&fs, 0, sizeof(fs));
+        char *html = fetch_html(url, &fs, NULL, NULL, NULL);
+        if (html) {
+            lat_record(url, LAT_TOTAL, fs.total_ms);
+            double t0 = mono_ms();
+            render_page(html, strlen(html), &o, &rs, NULL, &out);
+            lat_record(url, LAT_PARSE, mono_ms() - t0);
+            kno_free(html);
+        }
+        sl_free(&out);
+    }
+    mark_now(&b);
+    report("single", requests, &a, &b);
+}
+
+/* run_batch_mode over every page, with its own output sent to /dev/null. */
+static void run_batch(int port, size_t requests, long concurrency) {
+    char path[] = "/tmp/kno-url-loadbench-XXXXXX";
+    char conc[32];
+    Mark a, b;
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        fprintf(stderr, "[-] Could not create batch target file\n");
+        return;
+    }
+    FILE *f = fdopen(fd, "w");
+    for (size_t i = 0; i < requests; i++) fprintf(f, "http://127.0.0.1:%d/p/%zu.html\n", port, i % g_spec.pages);
+    fclose(f);
+
+    snprintf(conc, sizeof(conc), "%ld", concurrency);
+    char *args[] = { "--batch", path, "--concurrency", conc, "--report-every", "0" };
+    int saved = dup(STDOUT_FILENO);
+    int devnull = open("/dev/null", O_WRONLY);
+
+    mark_now(&a);
+    fflush(stdout);
+    if (devnull >= 0) dup2(devnull, STDOUT_FILENO);
+    run_batch_mode(args, (int)(sizeof(args) / sizeof(args[0])));
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    mark_now(&b);
+
+    if (devnull >= 0) close(devnull);
+    close(saved);
+    unlink(path);
+    report("batch", requests, &a, &b);
+}
+
+/*
+ * Each mode runs in its own forked child, so ru_maxrss is that mode's
+ * high-water mark and not the largest of every mode run so far.
+ */
+static void run_forked(const char *mode, int port, size_t requests, long concurrency) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (strcmp(mode, "single") == 0) run_single(port, requests);
+        else run_batch(port, requests, concurrency);
+        fflush(stdout);
+        _exit(0);
+    }
+    if (pid < 0 || waitpid(pid, NULL, 0) < 0) fprintf(stderr, "[-] Could not run %s mode\n", mode);
+}
+
+static size_t parse_size(const char *s) {
+    char *end;
+    double v = strtod(s, &end);
+    if (*end == 'k' || *end == 'K') v *= 1024.0;
+    else if (*end == 'm' || *end == 'M') v *= 1024.0 * 1024.0;
+    return v > 0 ? (size_t)v : 0;
+}
+
+int main(int argc, char **argv) {
+    const char *modes = "single,batch";
+    size_t requests = 0;
+    long concurrency = 8;
+    int port = 0;
+
+    g_spec.pages = 200;
+    g_spec.page_size = 64 * 1024;
+    g_spec.links = 20;
+    g_spec.gzip = 1;
+    g_spec.keepalive = 1;
+    g_spec.seed = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--pages") == 0 && i + 1 < argc) g_spec.pages = (size_t)atol(argv[++i]);
+        else if (strcmp(argv[i], "--page-size") == 0 && i + 1 < argc) g_spec.page_size = parse_size(argv[++i]);
+        else if (strcmp(argv[i], "--links") == 0 && i + 1 < argc) g_spec.links = (size_t)atol(argv[++i]);
+        else if (strcmp(argv[i], "--latency") == 0 && i + 1 < argc) g_spec.latency_ms = atol(argv[++i]);
+        else if (strcmp(argv[i], "--jitter") == 0 && i + 1 < argc) g_spec.jitter_ms = atol(argv[++i]);
+        else if (strcmp(argv[i], "--no-gzip") == 0) g_spec.gzip = 0;
+        else if (strcmp(argv[i], "--no-keepalive") == 0) g_spec.keepalive = 0;
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) g_spec.seed = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--requests") == 0 && i + 1 < argc) requests = (size_t)atol(argv[++i]);
+        else if (strcmp(argv[i], "--concurrency") == 0 && i + 1 < argc) concurrency = atol(argv[++i]);
+        else if (strcmp(argv[i], "--modes") == 0 && i + 1 < argc) modes = argv[++i];
+        else {
+            fprintf(stderr, "Usage: %s [--pages 200] [--page-size 64k] [--links 20] [--latency ms] [--jitter ms] "
+                            "[--no-gzip] [--no-keepalive] [--requests N] [--concurrency 8] [--seed 1] "
+                            "[--modes single,batch]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (g_spec.pages == 0 || g_spec.page_size == 0 || concurrency < 1) {
+        fprintf(stderr, "Error: --pages, --page-size and --concurrency must be positive.\n");
+        return 2;
+    }
+    if (requests == 0) requests = g_spec.pages;
+
+    if (!category_rules_init(NULL)) return 1;
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    /* The CLI sends no Accept-Encoding; ask for gzip so the server's gzip path is exercised. */
+    if (g_spec.gzip) g_accept_encoding = "gzip";
+    pid_t server = server_start(&port);
+    if (server < 0) {
+        fprintf(stderr, "[-] Could not start loopback server\n");
+        return 1;
+    }
+
+    printf("[*] Serving %zu pages of %zu bytes (%zu links each) on 127.0.0.1:%d, latency %ld+%ld ms, gzip %s, keep-alive %s\n",
+           g_spec.pages, g_spec.page_size, g_spec.links, port, g_spec.latency_ms, g_spec.jitter_ms,
+           g_spec.gzip ? "on" : "off", g_spec.keepalive ? "on" : "off");
+    printf("%-8s %8s %10s %10s %10s %10s %10s %10s\n", "mode", "requests", "req/s", "p50 ms", "p99 ms",
+           "parse p99", "cpu ms", "mode RSS");
+    if (strstr(modes, "single")) run_forked("single", port, requests, concurrency);
+    if (strstr(modes, "batch")) run_forked("batch", port, requests, concurrency);
+    if (strstr(modes, "crawl")) printf("%-8s (no crawl mode in this build, skipped)\n", "crawl");
+    printf("[*] mode RSS: peak resident MiB of the forked process that ran the mode\n");
+
+    kill(server, SIGTERM);
+    waitpid(server, NULL, 0);
+    curl_global_cleanup();
+    return 0;
+}
@@ -1,831 +1,5889 @@
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <ctype.h>
-#include <curl/curl.h>
-#include <sys/stat.h>
-
-#ifdef _WIN32
-#include <windows.h>
-#define PATH_SEP '\\'
-#else
-#include <unistd.h>
-#define PATH_SEP '/'
-#endif
-
-/*
- * Kusanagi Night Ops: URL Scrapper (C Edition)
- *
- * - HTML mode (URL scraping + categories + --search + --full + -o)
- * - Network mode -n:
- *      * Shows red-team warning about noise
- *      * If confirmed, prints "Network mode not supported in this version"
- * - --night-ops + optional -sd <duration>:
- *      * standalone: Main URL: --night-ops    -> confirm, cleanup, exit
- *      * with URL:   <url> ... --night-ops -sd <duration> -> run, sleep, cleanup, exit
- * - Cleanup is best-effort:
- *      * delete .kno-url directory (same dir as executable) if exists
- *      * delete executable file (based on argv[0])
- */
-
-#define MAX_LINE 4096
-
-/* ---------- Globals ---------- */
-static char *g_exe_path = NULL;
-
-/* ---------- Simple dynamic string list ---------- */
-typedef struct {
-    char **items;
-    size_t count;
-    size_t capacity;
-} StrList;
-
-static void sl_init(StrList *sl) {
-    sl->items = NULL;
-    sl->count = 0;
-    sl->capacity = 0;
-}
-
-static void sl_add(StrList *sl, const char *s) {
-    if (!s) return;
-    if (sl->count + 1 > sl->capacity) {
-        size_t newcap = (sl->capacity == 0) ? 16 : sl->capacity * 2;
-        char **ni = (char **)realloc(sl->items, newcap * sizeof(char *));
-        if (!ni) return;
-        sl->items = ni;
-        sl->capacity = newcap;
-    }
-    sl->items[sl->count] = strdup(s);
-    if (sl->items[sl->count]) {
-        sl->count++;
-    }
-}
-
-static void sl_free(StrList *sl) {
-    if (!sl) return;
-    for (size_t i = 0; i < sl->count; i++) {
-        free(sl->items[i]);
-    }
-    free(sl->items);
-    sl->items = NULL;
-    sl->count = 0;
-    sl->capacity = 0;
-}
-
-/* Case-insensitive substring search boolean */
-static int strcasestr_bool(const char *haystack, const char *needle) {
-    if (!haystack || !needle || !*needle) return 0;
-    size_t nh = strlen(haystack);
-    size_t nn = strlen(needle);
-    if (nn > nh) return 0;
-    for (size_t i = 0; i + nn <= nh; i++) {
-        size_t j;
-        for (j = 0; j < nn; j++) {
-            char c1 = (char)tolower((unsigned char)haystack[i + j]);
-            char c2 = (char)tolower((unsigned char)needle[j]);
-            if (c1 != c2) break;
-        }
-        if (j == nn) return 1;
-    }
-    return 0;
-}
-
-/* ---------- HTTP fetch via libcurl ---------- */
-struct MemoryBuffer {
-    char *data;
-    size_t size;
-};
-
-static size_t write_callback(void *contents, size_t size, size_t nmemb, void *userp) {
-    size_t realsize = size * nmemb;
-    struct MemoryBuffer *mem = (struct MemoryBuffer *)userp;
-
-    char *ptr = (char *)realloc(mem->data, mem->size + realsize + 1);
-    if (!ptr) return 0;
-    mem->data = ptr;
-    memcpy(&(mem->data[mem->size]), contents, realsize);
-    mem->size += realsize;
-    mem->data[mem->size] = '\0';
-    return realsize;
-}
-
-static char *fetch_html(const char *url) {
-    CURL *curl;
-    CURLcode res;
-    struct MemoryBuffer chunk;
-    chunk.data = NULL;
-    chunk.size = 0;
-
-    curl = curl_easy_init();
-    if (!curl) {
-        fprintf(stderr, "[-] Failed to init CURL\n");
-        return NULL;
-    }
-
-    curl_easy_setopt(curl, CURLOPT_URL, url);
-    curl_easy_setopt(curl, CURLOPT_USERAGENT, "KNO-URL-C/1.0");
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&chunk);
-    /* Ignore SSL errors like Python version */
-    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
-    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
-
-    res = curl_easy_perform(curl);
-    if (res != CURLE_OK) {
-        fprintf(stderr, "[-] CURL error fetching %s: %s\n", url, curl_easy_strerror(res));
-        curl_easy_cleanup(curl);
-        free(chunk.data);
-        return NULL;
-    }
-
-    curl_easy_cleanup(curl);
-    return chunk.data;  /* caller frees */
-}
-
-/* ---------- URL normalization & token parsing ---------- */
-static char *normalize_url(const char *u) {
-    if (!u || !*u) return NULL;
-    if (!strncmp(u, "http://", 7) || !strncmp(u, "https://", 8)) {
-        return strdup(u);
-    }
-    if (!strncmp(u, "www.", 4)) {
-        size_t len = strlen(u) + 9;
-        char *res = (char *)malloc(len);
-        if (!res) return NULL;
-        snprintf(res, len, "https://%s", u);
-        return res;
-    }
-    if (strchr(u, '.') || strchr(u, ':')) {
-        size_t len = strlen(u) + 9;
-        char *res = (char *)malloc(len);
-        if (!res) return NULL;
-        snprintf(res, len, "https://%s", u);
-        return res;
-    }
-    return strdup(u);
-}
-
-/* Split line into tokens (in-place, modifies buffer). Returns count. */
-static int split_tokens(char *line, char **tokens, int max_tokens) {
-    int count = 0;
-    char *p = line;
-    while (*p && count < max_tokens) {
-        while (isspace((unsigned char)*p)) p++;
-        if (!*p) break;
-        tokens[count++] = p;
-        while (*p && !isspace((unsigned char)*p)) p++;
-        if (*p) {
-            *p = '\0';
-            p++;
-        }
-    }
-    return count;
-}
-
-/* ---------- URL extraction (simplified) ---------- */
-static void extract_urls_from_html(const char *html, StrList *urls) {
-    const char *p = html;
-
-    /* http:// */
-    p = html;
-    while ((p = strstr(p, "http://")) != NULL) {
-        const char *start = p;
-        const char *q = p;
-        while (*q && !isspace((unsigned char)*q) && *q != '"' && *q != '\'' && *q != '<' && *q != '>') {
-            q++;
-        }
-        size_t len = (size_t)(q - start);
-        char *u = (char *)malloc(len + 1);
-        if (!u) return;
-        memcpy(u, start, len);
-        u[len] = '\0';
-        sl_add(urls, u);
-        free(u);
-        p = q;
-    }
-
-    /* https:// */
-    p = html;
-    while ((p = strstr(p, "https://")) != NULL) {
-        const char *start = p;
-        const char *q = p;
-        while (*q && !isspace((unsigned char)*q) && *q != '"' && *q != '\'' && *q != '<' && *q != '>') {
-            q++;
-        }
-        size_t len = (size_t)(q - start);
-        char *u = (char *)malloc(len + 1);
-        if (!u) return;
-        memcpy(u, start, len);
-        u[len] = '\0';
-        sl_add(urls, u);
-        free(u);
-        p = q;
-    }
-
-    /* blob: */
-    p = html;
-    while ((p = strstr(p, "blob:")) != NULL) {
-        const char *start = p;
-        const char *q = p;
-        while (*q && !isspace((unsigned char)*q) && *q != '"' && *q != '\'' && *q != '<' && *q != '>') {
-            q++;
-        }
-        size_t len = (size_t)(q - start);
-        char *u = (char *)malloc(len + 1);
-        if (!u) return;
-        memcpy(u, start, len);
-        u[len] = '\0';
-        sl_add(urls, u);
-        free(u);
-        p = q;
-    }
-}
-
-/* ---------- Categorization helpers ---------- */
-static const char *get_ext(const char *url) {
-    const char *p = strrchr(url, '.');
-    if (!p) return "";
-    const char *slash = strchr(p, '/');
-    if (slash) return "";
-    return p;
-}
-
-static const char *categorize_url(const char *url) {
-    const char *ext = get_ext(url);
-    char lower_ext[16];
-    size_t i;
-
-    if (strlen(ext) < sizeof(lower_ext)) {
-        for (i = 0; ext[i] && i < sizeof(lower_ext) - 1; i++) {
-            lower_ext[i] = (char)tolower((unsigned char)ext[i]);
-        }
-        lower_ext[i] = '\0';
-    } else {
-        lower_ext[0] = '\0';
-    }
-
-    if (strstr(url, "/api/") || strcasestr_bool(url, "graphql")) {
-        return "API / ENDPOINTS";
-    }
-
-    if (!strcmp(lower_ext, ".js") || !strcmp(lower_ext, ".mjs")) {
-        return "SCRIPTS";
-    }
-    if (!strcmp(lower_ext, ".png") || !strcmp(lower_ext, ".jpg") ||
-        !strcmp(lower_ext, ".jpeg") || !strcmp(lower_ext, ".gif") ||
-        !strcmp(lower_ext, ".svg") || !strcmp(lower_ext, ".webp") ||
-        !strcmp(lower_ext, ".ico") || !strcmp(lower_ext, ".mp4") ||
-        !strcmp(lower_ext, ".mov") || !strcmp(lower_ext, ".wav")) {
-        return "MEDIA";
-    }
-    if (!strcmp(lower_ext, ".json") || !strcmp(lower_ext, ".xml") ||
-        !strcmp(lower_ext, ".yml") || !strcmp(lower_ext, ".yaml") ||
-        !strcmp(lower_ext, ".pdf") || !strcmp(lower_ext, ".txt") ||
-        !strcmp(lower_ext, ".doc") || !strcmp(lower_ext, ".docx") ||
-        !strcmp(lower_ext, ".csv")) {
-        return "DOCUMENTS / CONFIG";
-    }
-    if (!strcmp(lower_ext, ".html") || !strcmp(lower_ext, ".htm") ||
-        strstr(url, ".bundle.js") || strstr(url, ".chunk.js")) {
-        return "HTML / FRAMEWORK";
-    }
-
-    return "OTHER";
-}
-
-/* ---------- Sorting by extension ---------- */
-typedef struct {
-    char *url;
-    const char *ext;
-} UrlWithExt;
-
-static int cmp_uwe(const void *a, const void *b) {
-    const UrlWithExt *ua = (const UrlWithExt *)a;
-    const UrlWithExt *ub = (const UrlWithExt *)b;
-    int c = strcmp(ua->ext, ub->ext);
-    if (c != 0) return c;
-    return strcmp(ua->url, ub->url);
-}
-
-/* ---------- Duration parsing (1h30m, 90s, etc.) ---------- */
-static long parse_duration_seconds(const char *s) {
-    if (!s || !*s) return -1;
-    char buf[128];
-    size_t bi = 0;
-    for (size_t i = 0; s[i] && bi < sizeof(buf) - 1; i++) {
-        if (!isspace((unsigned char)s[i])) {
-            buf[bi++] = (char)tolower((unsigned char)s[i]);
-        }
-    }
-    buf[bi] = '\0';
-    if (!buf[0]) return -1;
-
-    int all_digits = 1;
-    for (size_t i = 0; buf[i]; i++) {
-        if (!isdigit((unsigned char)buf[i])) {
-            all_digits = 0;
-            break;
-        }
-    }
-    if (all_digits) {
-        return atol(buf);
-    }
-
-    long total = 0;
-    size_t i = 0;
-    while (buf[i]) {
-        if (!isdigit((unsigned char)buf[i])) return -1;
-        long val = 0;
-        while (isdigit((unsigned char)buf[i])) {
-            val = val * 10 + (buf[i] - '0');
-            i++;
-        }
-        char unit = buf[i];
-        if (unit == 'h') {
-            total += val * 3600;
-            i++;
-        } else if (unit == 'm') {
-            total += val * 60;
-            i++;
-        } else if (unit == 's' || unit == '\0') {
-            total += val;
-            if (unit == 's') i++;
-        } else {
-            return -1;
-        }
-    }
-    return (total > 0) ? total : -1;
-}
-
-/* ---------- Night Ops cleanup ---------- */
-static void night_ops_cleanup(void) {
-    printf("[*] --night-ops: attempting local cleanup...\n");
-
-    if (g_exe_path) {
-        char *path_copy = strdup(g_exe_path);
-        if (path_copy) {
-            char *last_sep = NULL;
-            for (char *p = path_copy; *p; p++) {
-                if (*p == '/' || *p == '\\') last_sep = p;
-            }
-            if (last_sep) {
-                *last_sep = '\0';
-            } else {
-                strcpy(path_copy, ".");
-            }
-
-            size_t len = strlen(path_copy) + strlen("/.kno-url") + 1;
-            char *kno_dir = (char *)malloc(len);
-            if (kno_dir) {
-                snprintf(kno_dir, len, "%s/.kno-url", path_copy);
-                struct stat st;
-                if (stat(kno_dir, &st) == 0 && (st.st_mode & S_IFDIR)) {
-                    if (rmdir(kno_dir) == 0) {
-                        printf("[*] Removed directory %s (if empty).\n", kno_dir);
-                    } else {
-                        printf("[!] Could not remove directory (might not be empty): %s\n", kno_dir);
-                    }
-                }
-                free(kno_dir);
-            }
-            free(path_copy);
-        }
-
-        if (remove(g_exe_path) == 0) {
-            printf("[*] Removed executable %s\n", g_exe_path);
-        } else {
-            printf("[!] Could not delete executable (possibly in use): %s\n", g_exe_path);
-        }
-    }
-
-    printf("[+] Self-destruct complete. Exiting.\n");
-}
-
-/* ---------- HTML mode core ---------- */
-static void run_html_mode(const char *url, char **args, int argc) {
-    int use_scripts = 0, use_media = 0, use_api = 0, use_docs = 0, use_html = 0, use_other = 0;
-    int no_media_mode = 0;
-    char *output_file = NULL;
-    int full_mode = 0;
-    StrList search_terms; sl_init(&search_terms);
-
-    for (int i = 0; i < argc; i++) {
-        if (strcmp(args[i], "-s") == 0) use_scripts = 1;
-        else if (strcmp(args[i], "-md") == 0) use_media = 1;
-        else if (strcmp(args[i], "-a") == 0) use_api = 1;
-        else if (strcmp(args[i], "-d") == 0) use_docs = 1;
-        else if (strcmp(args[i], "-ht") == 0) use_html = 1;
-        else if (strcmp(args[i], "-O") == 0) use_other = 1;
-        else if (strcmp(args[i], "--no-media") == 0) no_media_mode = 1;
-        else if (strcmp(args[i], "-o") == 0 && i + 1 < argc) {
-            output_file = args[i + 1];
-            i++;
-        } else if (strcmp(args[i], "--search") == 0 && i + 1 < argc) {
-            char *val = args[i + 1];
-            char *tok = strtok(val, ",");
-            while (tok) {
-                while (*tok && isspace((unsigned char)*tok)) tok++;
-                if (*tok) sl_add(&search_terms, tok);
-                tok = strtok(NULL, ",");
-            }
-            i++;
-        } else if (strcmp(args[i], "--full") == 0) {
-            full_mode = 1;
-        }
-    }
-
-    printf("[*] Fetching HTML from %s ...\n", url);
-    char *html = fetch_html(url);
-    if (!html) {
-        sl_free(&search_terms);
-        return;
-    }
-
-    if (full_mode) {
-        if (output_file) {
-            FILE *f = fopen(output_file, "w");
-            if (f) {
-                fputs(html, f);
-                fclose(f);
-                printf("[*] Full HTML written to %s\n", output_file);
-            } else {
-                fprintf(stderr, "[-] Failed to write to %s\n", output_file);
-            }
-        }
-        printf("%s\n", html);
-        free(html);
-        sl_free(&search_terms);
-        return;
-    }
-
-    StrList all_urls; sl_init(&all_urls);
-    extract_urls_from_html(html, &all_urls);
-
-    StrList cat_scripts, cat_media, cat_api, cat_docs, cat_html_list, cat_other;
-    sl_init(&cat_scripts); sl_init(&cat_media); sl_init(&cat_api);
-    sl_init(&cat_docs); sl_init(&cat_html_list); sl_init(&cat_other);
-
-    int have_cat_flags = use_scripts || use_media || use_api || use_docs || use_html || use_other;
-
-    for (size_t j = 0; j < all_urls.count; j++) {
-        const char *u = all_urls.items[j];
-
-        int keep = 1;
-        if (search_terms.count > 0) {
-            keep = 0;
-            for (size_t st = 0; st < search_terms.count; st++) {
-                if (strcasestr_bool(u, search_terms.items[st])) {
-                    keep = 1;
-                    break;
-                }
-            }
-        }
-        if (!keep) continue;
-
-        const char *cat = categorize_url(u);
-
-        if (have_cat_flags) {
-            int wanted = 0;
-            if (strcmp(cat, "SCRIPTS") == 0 && use_scripts) wanted = 1;
-            if (strcmp(cat, "MEDIA") == 0   && use_media)   wanted = 1;
-            if (strcmp(cat, "API / ENDPOINTS") == 0 && use_api) wanted = 1;
-            if (strcmp(cat, "DOCUMENTS / CONFIG") == 0 && use_docs) wanted = 1;
-            if (strcmp(cat, "HTML / FRAMEWORK") == 0 && use_html) wanted = 1;
-            if (strcmp(cat, "OTHER") == 0 && use_other) wanted = 1;
-            if (!wanted) continue;
-        }
-
-        if (no_media_mode) {
-            int excluded = 0;
-            if (strcmp(cat, "SCRIPTS") == 0 && use_scripts) excluded = 1;
-            if (strcmp(cat, "MEDIA") == 0   && use_media)   excluded = 1;
-            if (strcmp(cat, "API / ENDPOINTS") == 0 && use_api) excluded = 1;
-            if (strcmp(cat, "DOCUMENTS / CONFIG") == 0 && use_docs) excluded = 1;
-            if (strcmp(cat, "HTML / FRAMEWORK") == 0 && use_html) excluded = 1;
-            if (strcmp(cat, "OTHER") == 0 && use_other) excluded = 1;
-            if (excluded) continue;
-        }
-
-        if (strcmp(cat, "SCRIPTS") == 0) sl_add(&cat_scripts, u);
-        else if (strcmp(cat, "MEDIA") == 0) sl_add(&cat_media, u);
-        else if (strcmp(cat, "API / ENDPOINTS") == 0) sl_add(&cat_api, u);
-        else if (strcmp(cat, "DOCUMENTS / CONFIG") == 0) sl_add(&cat_docs, u);
-        else if (strcmp(cat, "HTML / FRAMEWORK") == 0) sl_add(&cat_html_list, u);
-        else sl_add(&cat_other, u);
-    }
-
-    StrList *cats[6] = {&cat_scripts, &cat_media, &cat_api, &cat_docs, &cat_html_list, &cat_other};
-    const char *names[6] = {"SCRIPTS", "MEDIA", "API / ENDPOINTS",
-                            "DOCUMENTS / CONFIG", "HTML / FRAMEWORK", "OTHER"};
-
-    StrList out_lines; sl_init(&out_lines);
-
-    for (int c = 0; c < 6; c++) {
-        StrList *cl = cats[c];
-        if (cl->count == 0) continue;
-
-        UrlWithExt *with_ext = (UrlWithExt *)calloc(cl->count, sizeof(UrlWithExt));
-        StrList no_ext; sl_init(&no_ext);
-        size_t we_count = 0;
-
-        for (size_t j = 0; j < cl->count; j++) {
-            const char *u = cl->items[j];
-            const char *ext = get_ext(u);
-            if (ext && *ext) {
-                with_ext[we_count].url = (char *)u;
-                with_ext[we_count].ext = ext;
-                we_count++;
-            } else {
-                sl_add(&no_ext, u);
-            }
-        }
-
-        if (we_count > 0) {
-            qsort(with_ext, we_count, sizeof(UrlWithExt), cmp_uwe);
-        }
-
-        sl_add(&out_lines, names[c]);
-        for (size_t j = 0; j < we_count; j++) {
-            sl_add(&out_lines, with_ext[j].url);
-        }
-        for (size_t j = 0; j < no_ext.count; j++) {
-            sl_add(&out_lines, no_ext.items[j]);
-        }
-        sl_add(&out_lines, "");
-
-        sl_free(&no_ext);
-        free(with_ext);
-    }
-
-    if (out_lines.count > 0) {
-        for (size_t j = 0; j < out_lines.count; j++) {
-            printf("%s\n", out_lines.items[j]);
-        }
-        if (output_file) {
-            FILE *f = fopen(output_file, "w");
-            if (f) {
-                for (size_t j = 0; j < out_lines.count; j++) {
-                    fputs(out_lines.items[j], f);
-                    fputc('\n', f);
-                }
-                fclose(f);
-                printf("[*] Results written to %s\n", output_file);
-            } else {
-                fprintf(stderr, "[-] Failed to write to %s\n", output_file);
-            }
-        }
-    } else {
-        printf("[*] No URLs matched filters.\n");
-    }
-
-    sl_free(&all_urls);
-    sl_free(&cat_scripts);
-    sl_free(&cat_media);
-    sl_free(&cat_api);
-    sl_free(&cat_docs);
-    sl_free(&cat_html_list);
-    sl_free(&cat_other);
-    sl_free(&out_lines);
-    sl_free(&search_terms);
-    free(html);
-}
-
-/* ---------- Main loop with Night Ops semantics ---------- */
-int main(int argc, char **argv) {
-    char line[MAX_LINE];
-
-    if (argc > 0 && argv[0]) {
-        g_exe_path = strdup(argv[0]);
-    }
-
-    curl_global_init(CURL_GLOBAL_DEFAULT);
-    printf("Kusanagi Night Ops: URL Scrapper (C Edition)\n");
-
-    for (;;) {
-        printf("Main URL: ");
-        fflush(stdout);
-        if (!fgets(line, sizeof(line), stdin)) break;
-
-        size_t len = strlen(line);
-        if (len > 0 && line[len-1] == '\n') line[len-1] = '\0';
-        if (line[0] == '\0') {
-            printf("[-] No URL detected. Use -h or --help for usage.\n");
-            continue;
-        }
-
-        char *tokens[64];
-        int ntok = split_tokens(line, tokens, 64);
-        if (ntok == 0) {
-            printf("[-] No URL detected.\n");
-            continue;
-        }
-
-        /* Help */
-        if (ntok == 1 && (strcmp(tokens[0], "-h") == 0 || strcmp(tokens[0], "--help") == 0)) {
-            printf("Kusanagi Night Ops: URL Scrapper (C Edition)\n");
-            printf("HTML mode flags:\n");
-            printf("  -s -md -a -d -ht -O    category filters\n");
-            printf("  --no-media             treat selected as exclusions\n");
-            printf("  --search term1,term2   substring filter\n");
-            printf("  --full                 dump full HTML\n");
-            printf("  -o file                write output to file\n");
-            printf("Network mode:\n");
-            printf("  -n                     Network mode not supported in this version (with noise warning)\n");
-            printf("Night Ops:\n");
-            printf("  --night-ops            cleanup & self-destruct\n");
-            printf("  --night-ops -sd 90s    schedule self-destruct\n");
-            continue;
-        }
-
-        /* Standalone --night-ops (no URL, no other tokens) */
-        if (ntok == 1 && strcmp(tokens[0], "--night-ops") == 0) {
-            char ans[16];
-            printf("[!] --night-ops will attempt to delete this binary and local .kno-url dir. Proceed? [y/N]: ");
-            if (!fgets(ans, sizeof(ans), stdin)) {
-                printf("\n[*] --night-ops canceled.\n");
-                continue;
-            }
-            if (ans[0] == 'y' || ans[0] == 'Y') {
-                night_ops_cleanup();
-                curl_global_cleanup();
-                return 0;
-            } else {
-                printf("[*] --night-ops canceled; no cleanup performed.\n");
-                continue;
-            }
-        }
-
-        /* URL parsing */
-        char *url = NULL;
-        int arg_start = 0;
-
-        if (strcmp(tokens[0], "-u") == 0 && ntok >= 2) {
-            url = normalize_url(tokens[1]);
-            arg_start = 2;
-        } else if (tokens[0][0] != '-') {
-            url = normalize_url(tokens[0]);
-            arg_start = 1;
-        } else {
-            for (int i = 0; i < ntok; i++) {
-                if (!strncmp(tokens[i], "http://", 7) ||
-                    !strncmp(tokens[i], "https://", 8) ||
-                    !strncmp(tokens[i], "www.", 4)) {
-                    url = normalize_url(tokens[i]);
-                    arg_start = i + 1;
-                    break;
-                }
-            }
-        }
-
-        char *args[64];
-        int aargc = 0;
-        for (int i = arg_start; i < ntok && aargc < 64; i++) {
-            args[aargc++] = tokens[i];
-        }
-
-        if (!url) {
-            printf("[-] No URL detected. Use -h or --help for usage, or use '--night-ops' alone.\n");
-            continue;
-        }
-
-        /* Parse Night Ops & -sd duration */
-        int night_ops = 0;
-        long sd_seconds = -1;
-
-        for (int i = 0; i < aargc; i++) {
-            if (strcmp(args[i], "--night-ops") == 0) night_ops = 1;
-        }
-
-        for (int i = 0; i < aargc; i++) {
-            if (strcmp(args[i], "-sd") == 0) {
-                char durbuf[128];
-                durbuf[0] = '\0';
-                int j = i + 1;
-                int first = 1;
-                while (j < aargc && args[j][0] != '-') {
-                    if (!first) strncat(durbuf, " ", sizeof(durbuf) - strlen(durbuf) - 1);
-                    strncat(durbuf, args[j], sizeof(durbuf) - strlen(durbuf) - 1);
-                    first = 0;
-                    j++;
-                }
-                if (durbuf[0] == '\0') {
-                    printf("Error: -sd requires a duration like '90s' or '1h30m'.\n");
-                    free(url);
-                    goto loop_continue;
-                }
-                sd_seconds = parse_duration_seconds(durbuf);
-                if (sd_seconds <= 0) {
-                    printf("Error: invalid -sd duration: %s\n", durbuf);
-                    free(url);
-                    goto loop_continue;
-                }
-                int new_aargc = 0;
-                for (int k = 0; k < aargc; k++) {
-                    if (k == i) {
-                        k = j - 1;
-                        continue;
-                    }
-                    args[new_aargc++] = args[k];
-                }
-                aargc = new_aargc;
-                break;
-            }
-        }
-
-        if (sd_seconds >= 0 && !night_ops) {
-            printf("Error: -sd can only be used together with --night-ops.\n");
-            free(url);
-            goto loop_continue;
-        }
-
-        if (night_ops && sd_seconds < 0) {
-            printf("Error: --night-ops can't be ran along side other commands unless -sd is defined with a time to execute\n");
-            free(url);
-            goto loop_continue;
-        }
-
-        if (night_ops) {
-            int new_aargc = 0;
-            for (int i = 0; i < aargc; i++) {
-                if (strcmp(args[i], "--night-ops") == 0) continue;
-                args[new_aargc++] = args[i];
-            }
-            aargc = new_aargc;
-        }
-
-        /* Network mode stub with red-team warning */
-        int net_mode = 0;
-        for (int i = 0; i < aargc; i++) {
-            if (strcmp(args[i], "-n") == 0) {
-                net_mode = 1;
-                break;
-            }
-        }
-        if (net_mode) {
-            char ans[16];
-            printf("WARNING: Network mode may be noisy for a stealthy Red Team Op, would you like to proceed? [y/N]: ");
-            if (!fgets(ans, sizeof(ans), stdin)) {
-                printf("\n[*] Network mode canceled.\n");
-            } else {
-                if (ans[0] == 'y' || ans[0] == 'Y') {
-                    printf("Network mode not supported in this version\n");
-                } else {
-                    printf("[*] Network mode canceled.\n");
-                }
-            }
-            free(url);
-            goto loop_continue;
-        }
-
-        /* Unknown flags detection */
-        const char *valid_flags[] = {
-            "-s","-md","-a","-d","-ht","-O",
-            "--no-media","--search","--full",
-            "-o","-u","-h","--help"
-        };
-        int nvalid = (int)(sizeof(valid_flags)/sizeof(valid_flags[0]));
-        int bad = 0;
-        for (int i = 0; i < aargc; i++) {
-            if (args[i][0] != '-') continue;
-            int known = 0;
-            for (int j = 0; j < nvalid; j++) {
-                if (strcmp(args[i], valid_flags[j]) == 0) {
-                    known = 1;
-                    break;
-                }
-            }
-            if (!known) {
-                printf("Error: That flag does not exist: %s\n", args[i]);
-                bad = 1;
-                break;
-            }
-        }
-        if (bad) {
-            free(url);
-            goto loop_continue;
-        }
-
-        run_html_mode(url, args, aargc);
-
-        if (night_ops && sd_seconds > 0) {
-            printf("[*] --night-ops scheduled via -sd, sleeping for %ld seconds before cleanup...\n", sd_seconds);
-#ifdef _WIN32
-            Sleep((DWORD)(sd_seconds * 1000));
-#else
-            sleep((unsigned int)sd_seconds);
-#endif
-            night_ops_cleanup();
-            curl_global_cleanup();
-            free(url);
-            return 0;
-        }
-
-        free(url);
-    loop_continue:
-        continue;
-    }
-
-    curl_global_cleanup();
-    free(g_exe_path);
-    return 0;
-}
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <stdarg.h>
+#if !defined(_WIN32) && !defined(KNO_CURL_LINKED)
+#define KNO_CURL_DLOPEN 1
+#define CURL_DISABLE_TYPECHECK      /* curl_easy_setopt & co. become g_curl calls below */
+#endif
+#include <curl/curl.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#define PATH_SEP '\\'
+#else
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/resource.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <signal.h>
+#define PATH_SEP '/'
+#endif
+#ifdef __linux__
+#include <linux/perf_event.h>
+#endif
+#ifdef KNO_ZLIB
+#include <zlib.h>
+#endif
+#if defined(KNO_TLS_RESUME) && !defined(_WIN32)
+#include <fcntl.h>
+#include <openssl/ssl.h>
+#include <openssl/evp.h>
+#endif
+
+/*
+ * Kusanagi Night Ops: URL Scrapper (C Edition)
+ *
+ * - HTML mode (URL scraping + categories + --search + --full + -o)
+ * - Network mode -n:
+ *      * Shows red-team warning about noise
+ *      * If confirmed, prints "Network mode not supported in this version"
+ * - --night-ops + optional -sd <duration>:
+ *      * standalone: Main URL: --night-ops    -> confirm, cleanup, exit
+ *      * with URL:   <url> ... --night-ops -sd <duration> -> run, sleep, cleanup, exit
+ * - Cleanup is best-effort:
+ *      * delete .kno-url (same dir as executable) and the files kno-url keeps there
+ *      * delete executable file (based on argv[0])
+ */
+
+#define MAX_LINE 4096
+
+/* ---------- libcurl loading ---------- */
+/*
+ * The CLI does not link libcurl: net_init() dlopen()s it on the first
+ * command that needs the network, so --input runs, --help and the REPL
+ * prompt start without mapping libcurl and its TLS and HTTP/2 libraries.
+ * Every curl_* call in this file goes through g_curl. -DKNO_CURL_LINKED
+ * links it the usual way instead; the embedders (kno-url-bench.c,
+ * kno-url-loadbench.c, libkno-url.c) and Windows builds do.
+ */
+#ifdef KNO_CURL_DLOPEN
+#include <dlfcn.h>
+
+#define KNO_CURL_FUNCS(X) \
+    X(global_init) X(global_cleanup) X(version_info) X(free) \
+    X(easy_init) X(easy_setopt) X(easy_perform) X(easy_getinfo) X(easy_cleanup) X(easy_strerror) \
+    X(multi_init) X(multi_setopt) X(multi_add_handle) X(multi_remove_handle) X(multi_perform) \
+    X(multi_poll) X(multi_wakeup) X(multi_info_read) X(multi_cleanup) \
+    X(share_init) X(share_setopt) X(share_cleanup) X(slist_append) X(slist_free_all) \
+    X(url) X(url_set) X(url_get) X(url_cleanup)
+
+static struct {
+    void *lib;
+#define X(name) __typeof__(curl_##name) *name;
+    KNO_CURL_FUNCS(X)
+#undef X
+} g_curl;
+
+/* Returns 0 (with a message) when no usable libcurl is installed. */
+static int curl_load(void) {
+    static const char *names[] = { "libcurl.so.4", "libcurl.so", "libcurl.4.dylib", "libcurl.dylib" };
+    void *lib = NULL;
+    if (g_curl.lib) return 1;
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]) && !lib; i++) lib = dlopen(names[i], RTLD_NOW);
+    if (!lib) {
+        fprintf(stderr, "[-] Could not load libcurl: %s\n", dlerror());
+        return 0;
+    }
+#define X(name) \
+    if (!(*(void **)&g_curl.name = dlsym(lib, "curl_" #name))) { \
+        fprintf(stderr, "[-] libcurl has no curl_%s (7.68 or later is needed)\n", #name); \
+        dlclose(lib); \
+        return 0; \
+    }
+    KNO_CURL_FUNCS(X)
+#undef X
+    g_curl.lib = lib;
+    return 1;
+}
+
+/* Newer curl.h defines the variadic setters as pass-through macros. */
+#undef curl_easy_setopt
+#undef curl_easy_getinfo
+#undef curl_multi_setopt
+#undef curl_share_setopt
+#define curl_global_init g_curl.global_init
+#define curl_global_cleanup g_curl.global_cleanup
+#define curl_version_info g_curl.version_info
+#define curl_free g_curl.free
+#define curl_easy_init g_curl.easy_init
+#define curl_easy_setopt g_curl.easy_setopt
+#define curl_easy_perform g_curl.easy_perform
+#define curl_easy_getinfo g_curl.easy_getinfo
+#define curl_easy_cleanup g_curl.easy_cleanup
+#define curl_easy_strerror g_curl.easy_strerror
+#define curl_multi_init g_curl.multi_init
+#define curl_multi_setopt g_curl.multi_setopt
+#define curl_multi_add_handle g_curl.multi_add_handle
+#define curl_multi_remove_handle g_curl.multi_remove_handle
+#define curl_multi_perform g_curl.multi_perform
+#define curl_multi_poll g_curl.multi_poll
+#define curl_multi_wakeup g_curl.multi_wakeup
+#define curl_multi_info_read g_curl.multi_info_read
+#define curl_multi_cleanup g_curl.multi_cleanup
+#define curl_share_init g_curl.share_init
+#define curl_share_setopt g_curl.share_setopt
+#define curl_share_cleanup g_curl.share_cleanup
+#define curl_slist_append g_curl.slist_append
+#define curl_slist_free_all g_curl.slist_free_all
+#define curl_url g_curl.url
+#define curl_url_set g_curl.url_set
+#define curl_url_get g_curl.url_get
+#define curl_url_cleanup g_curl.url_cleanup
+#else
+static int curl_load(void) { return 1; }
+#endif
+
+/* ---------- Globals ---------- */
+static char *g_exe_path = NULL;
+static struct curl_slist *g_hosts_map = NULL;     /* --hosts-map, CURLOPT_RESOLVE for every handle */
+static const char *g_accept_encoding = NULL;      /* CURLOPT_ACCEPT_ENCODING for page fetches; embedders only */
+
+/* ---------- Allocation accounting (-DKNO_ALLOC_STATS) ---------- */
+/*
+ * Every allocation in this file goes through kno_malloc & co. In a normal
+ * build they are the libc calls; built with -DKNO_ALLOC_STATS each block
+ * carries a size header and is charged to the calling thread's current
+ * phase, and --stats prints the per-phase counts.
+ */
+enum { MEM_FETCH, MEM_EXTRACT, MEM_CATEGORIZE, MEM_SORT, MEM_OUTPUT, MEM_OTHER, MEM_PHASE_COUNT };
+
+#ifdef KNO_ALLOC_STATS
+static const char *k_mem_phase_names[MEM_PHASE_COUNT] = {
+    "fetch buf", "extract", "categories", "sort", "out_lines", "other"
+};
+
+typedef struct {
+    atomic_size_t allocs;
+    atomic_size_t bytes;
+    atomic_size_t largest;  /* biggest single block: buffer high-water mark */
+} MemPhase;
+
+static MemPhase g_mem[MEM_PHASE_COUNT];
+static atomic_size_t g_mem_live = 0;
+static atomic_size_t g_mem_peak = 0;
+static _Thread_local int t_mem_phase = MEM_OTHER;
+
+#define MEM_HDR 16
+
+static void mem_charge(size_t n, size_t old) {
+    MemPhase *ph = &g_mem[t_mem_phase];
+    atomic_fetch_add_explicit(&ph->allocs, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&ph->bytes, n, memory_order_relaxed);
+    size_t big = atomic_load_explicit(&ph->largest, memory_order_relaxed);
+    while (n > big && !atomic_compare_exchange_weak_explicit(&ph->largest, &big, n, memory_order_relaxed,
+                                                             memory_order_relaxed)) {
+    }
+    size_t live = atomic_fetch_add_explicit(&g_mem_live, n - old, memory_order_relaxed) + n - old;
+    size_t peak = atomic_load_explicit(&g_mem_peak, memory_order_relaxed);
+    while (live > peak && !atomic_compare_exchange_weak_explicit(&g_mem_peak, &peak, live, memory_order_relaxed,
+                                                                 memory_order_relaxed)) {
+    }
+}
+
+static void *kno_malloc(size_t n) {
+    unsigned char *p = (unsigned char *)malloc(n + MEM_HDR);
+    if (!p) return NULL;
+    memcpy(p, &n, sizeof(n));
+    mem_charge(n, 0);
+    return p + MEM_HDR;
+}
+
+static void *kno_calloc(size_t n, size_t sz) {
+    void *p = (sz && n > SIZE_MAX / sz) ? NULL : kno_malloc(n * sz);
+    if (p) memset(p, 0, n * sz);
+    return p;
+}
+
+static void *kno_realloc(void *ptr, size_t n) {
+    size_t old = 0;
+    unsigned char *base = NULL;
+    if (ptr) {
+        base = (unsigned char *)ptr - MEM_HDR;
+        memcpy(&old, base, sizeof(old));
+    }
+    unsigned char *p = (unsigned char *)realloc(base, n + MEM_HDR);
+    if (!p) return NULL;
+    memcpy(p, &n, sizeof(n));
+    mem_charge(n, old);
+    return p + MEM_HDR;
+}
+
+static char *kno_strdup(const char *s) {
+    size_t n = strlen(s) + 1;
+    char *d = (char *)kno_malloc(n);
+    if (d) memcpy(d, s, n);
+    return d;
+}
+
+static void kno_free(void *ptr) {
+    size_t old;
+    if (!ptr) return;
+    unsigned char *base = (unsigned char *)ptr - MEM_HDR;
+    memcpy(&old, base, sizeof(old));
+    atomic_fetch_sub_explicit(&g_mem_live, old, memory_order_relaxed);
+    free(base);
+}
+
+static void mem_phase(int phase) {
+    t_mem_phase = phase;
+}
+
+static void mem_reset(void) {
+    for (int ph = 0; ph < MEM_PHASE_COUNT; ph++) {
+        atomic_store(&g_mem[ph].allocs, 0);
+        atomic_store(&g_mem[ph].bytes, 0);
+        atomic_store(&g_mem[ph].largest, 0);
+    }
+    atomic_store(&g_mem_peak, atomic_load(&g_mem_live));
+}
+
+static void mem_print(void) {
+    for (int ph = 0; ph < MEM_PHASE_COUNT; ph++) {
+        size_t allocs = atomic_load(&g_mem[ph].allocs);
+        if (!allocs) continue;
+        printf("[*] alloc %-10s %10zu calls %12zu bytes  largest %zu\n", k_mem_phase_names[ph], allocs,
+               atomic_load(&g_mem[ph].bytes), atomic_load(&g_mem[ph].largest));
+    }
+    printf("[*] alloc live %zu bytes, peak live %zu bytes\n", atomic_load(&g_mem_live), atomic_load(&g_mem_peak));
+}
+#else
+#define kno_malloc(n) malloc(n)
+#define kno_calloc(n, sz) calloc(n, sz)
+#define kno_realloc(p, n) realloc(p, n)
+#define kno_strdup(s) strdup(s)
+#define kno_free(p) free(p)
+#define mem_phase(phase) ((void)(phase))
+#define mem_reset() ((void)0)
+#define mem_print() ((void)0)
+#endif
+
+/* ---------- Simple dynamic string list ---------- */
+typedef struct {
+    char **items;
+    size_t count;
+    size_t capacity;
+} StrList;
+
+static void sl_init(StrList *sl) {
+    sl->items = NULL;
+    sl->count = 0;
+    sl->capacity = 0;
+}
+
+static void sl_add(StrList *sl, const char *s) {
+    if (!s) return;
+    if (sl->count + 1 > sl->capacity) {
+        size_t newcap = (sl->capacity == 0) ? 16 : sl->capacity * 2;
+        char **ni = (char **)kno_realloc(sl->items, newcap * sizeof(char *));
+        if (!ni) return;
+        sl->items = ni;
+        sl->capacity = newcap;
+    }
+    sl->items[sl->count] = kno_strdup(s);
+    if (sl->items[sl->count]) {
+        sl->count++;
+    }
+}
+
+/* Add a copy of the first len bytes of s. */
+static void sl_add_n(StrList *sl, const char *s, size_t len) {
+    if (sl->count + 1 > sl->capacity) {
+        size_t newcap = (sl->capacity == 0) ? 16 : sl->capacity * 2;
+        char **ni = (char **)kno_realloc(sl->items, newcap * sizeof(char *));
+        if (!ni) return;
+        sl->items = ni;
+        sl->capacity = newcap;
+    }
+    char *c = (char *)kno_malloc(len + 1);
+    if (!c) return;
+    memcpy(c, s, len);
+    c[len] = '\0';
+    sl->items[sl->count++] = c;
+}
+
+static void sl_free(StrList *sl) {
+    if (!sl) return;
+    for (size_t i = 0; i < sl->count; i++) {
+        kno_free(sl->items[i]);
+    }
+    kno_free(sl->items);
+    sl->items = NULL;
+    sl->count = 0;
+    sl->capacity = 0;
+}
+
+/* ---------- Case-folded substring matcher ---------- */
+/*
+ * Needles are folded once per command. Candidates are found by comparing the
+ * folded first and last needle bytes against whole 32-byte blocks of the
+ * haystack (AVX2 where the CPU has it), and only those positions are verified
+ * byte by byte. Folding is ASCII-only, same as tolower() in the C locale.
+ */
+typedef struct {
+    const char *lower;      /* folded needle (owned unless statically built) */
+    size_t len;
+    unsigned char first, first_up;
+    unsigned char last, last_up;
+} Needle;
+
+static unsigned char fold_ascii(unsigned char c) {
+    return (unsigned char)((unsigned)(c - 'A') < 26u ? (c | 0x20) : c);
+}
+
+static unsigned char unfold_ascii(unsigned char c) {
+    return (unsigned char)((unsigned)(c - 'a') < 26u ? (c & ~0x20) : c);
+}
+
+static int needle_init(Needle *n, const char *s) {
+    size_t len = strlen(s);
+    char *lower = (char *)kno_malloc(len + 1);
+    memset(n, 0, sizeof(*n));
+    if (!lower) return 0;
+    for (size_t i = 0; i < len; i++) {
+        lower[i] = (char)fold_ascii((unsigned char)s[i]);
+    }
+    lower[len] = '\0';
+    n->lower = lower;
+    n->len = len;
+    if (len > 0) {
+        n->first = (unsigned char)lower[0];
+        n->last = (unsigned char)lower[len - 1];
+        n->first_up = unfold_ascii(n->first);
+        n->last_up = unfold_ascii(n->last);
+    }
+    return 1;
+}
+
+static void needle_free(Needle *n) {
+    if (!n) return;
+    kno_free((void *)n->lower);
+    n->lower = NULL;
+    n->len = 0;
+}
+
+/* Compare the inner bytes of a candidate; hay is already known to match at both ends. */
+static int needle_verify(const Needle *n, const char *hay) {
+    for (size_t j = 1; j + 1 < n->len; j++) {
+        if (fold_ascii((unsigned char)hay[j]) != (unsigned char)n->lower[j]) return 0;
+    }
+    return 1;
+}
+
+static int needle_match_scalar(const Needle *n, const char *hay, size_t nh, size_t start) {
+    for (size_t i = start; i + n->len <= nh; i++) {
+        if (fold_ascii((unsigned char)hay[i]) != n->first) continue;
+        if (fold_ascii((unsigned char)hay[i + n->len - 1]) != n->last) continue;
+        if (needle_verify(n, hay + i)) return 1;
+    }
+    return 0;
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define KNO_HAVE_AVX2 1
+
+__attribute__((target("avx2")))
+static int needle_match_avx2(const Needle *n, const char *hay, size_t nh) {
+    const __m256i f_lo = _mm256_set1_epi8((char)n->first);
+    const __m256i f_up = _mm256_set1_epi8((char)n->first_up);
+    const __m256i l_lo = _mm256_set1_epi8((char)n->last);
+    const __m256i l_up = _mm256_set1_epi8((char)n->last_up);
+    size_t i = 0;
+
+    for (; i + n->len - 1 + 32 <= nh; i += 32) {
+        __m256i bf = _mm256_loadu_si256((const __m256i *)(hay + i));
+        __m256i bl = _mm256_loadu_si256((const __m256i *)(hay + i + n->len - 1));
+        __m256i ef = _mm256_or_si256(_mm256_cmpeq_epi8(bf, f_lo), _mm256_cmpeq_epi8(bf, f_up));
+        __m256i el = _mm256_or_si256(_mm256_cmpeq_epi8(bl, l_lo), _mm256_cmpeq_epi8(bl, l_up));
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(_mm256_and_si256(ef, el));
+        while (mask) {
+            unsigned int bit = (unsigned int)__builtin_ctz(mask);
+            if (needle_verify(n, hay + i + bit)) return 1;
+            mask &= mask - 1;
+        }
+    }
+    return needle_match_scalar(n, hay, nh, i);
+}
+
+static int cpu_has_avx2(void) {
+    static int cached = -1;
+    if (cached < 0) {
+        __builtin_cpu_init();
+        cached = __builtin_cpu_supports("avx2") ? 1 : 0;
+    }
+    return cached;
+}
+#endif
+
+/* Case-insensitive substring search boolean (hay of known length) */
+static int needle_match(const Needle *n, const char *hay, size_t nh) {
+    if (!hay || n->len == 0 || n->len > nh) return 0;
+#ifdef KNO_HAVE_AVX2
+    if (cpu_has_avx2()) return needle_match_avx2(n, hay, nh);
+#endif
+    return needle_match_scalar(n, hay, nh, 0);
+}
+
+/* ---------- Hardware counters (--stats, Linux perf_event_open) ---------- */
+/*
+ * One counter group (cycles leading instructions, cache misses and branch
+ * misses) for the calling thread, user space only so the default
+ * perf_event_paranoid setting allows it. The group is enabled only between
+ * hw_begin() and hw_end(). If the leader cannot be opened (no PMU, seccomp,
+ * non-Linux) everything is skipped silently; members that fail print "n/a".
+ */
+enum { HW_CYCLES, HW_INSTRUCTIONS, HW_CACHE_MISSES, HW_BRANCH_MISSES, HW_COUNT };
+
+typedef struct {
+    uint64_t v[HW_COUNT];
+} HwSample;
+
+#ifdef __linux__
+static int g_hw_fd[HW_COUNT] = {-1, -1, -1, -1};
+static int g_hw_state = 0;     /* 0 untried, 1 open, -1 unavailable */
+
+static int hw_open(void) {
+    static const uint64_t configs[HW_COUNT] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+    };
+    if (g_hw_state) return g_hw_state > 0;
+    g_hw_state = -1;
+    for (int i = 0; i < HW_COUNT; i++) {
+        struct perf_event_attr pe;
+        memset(&pe, 0, sizeof(pe));
+        pe.type = PERF_TYPE_HARDWARE;
+        pe.size = sizeof(pe);
+        pe.config = configs[i];
+        pe.disabled = i == 0;
+        pe.exclude_kernel = 1;
+        pe.exclude_hv = 1;
+        pe.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        g_hw_fd[i] = (int)syscall(SYS_perf_event_open, &pe, 0, -1, i == 0 ? -1 : g_hw_fd[0], 0);
+        if (i == 0 && g_hw_fd[0] < 0) return 0;
+    }
+    g_hw_state = 1;
+    return 1;
+}
+
+static void hw_begin(void) {
+    ioctl(g_hw_fd[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(g_hw_fd[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+/* Stop the group and add its (multiplex-scaled) counts to acc. */
+static void hw_end(HwSample *acc) {
+    uint64_t buf[3 + HW_COUNT];
+    ioctl(g_hw_fd[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    ssize_t r = read(g_hw_fd[0], buf, sizeof(buf));
+    if (r < (ssize_t)(3 * sizeof(uint64_t)) || buf[2] == 0) return;
+    double scale = (double)buf[1] / (double)buf[2];
+    size_t slot = 0;
+    for (int i = 0; i < HW_COUNT && slot < buf[0]; i++) {
+        if (g_hw_fd[i] < 0) continue;
+        acc->v[i] += (uint64_t)((double)buf[3 + slot] * scale);
+        slot++;
+    }
+}
+
+static int hw_have(int counter) {
+    return g_hw_fd[counter] >= 0;
+}
+#else
+static int hw_open(void) { return 0; }
+static void hw_begin(void) {}
+static void hw_end(HwSample *acc) { (void)acc; }
+static int hw_have(int counter) { (void)counter; return 0; }
+#endif
+
+/* ---------- Timing & stats (--stats) ---------- */
+/*
+ * Clocks are only read when --stats is on; with it off each phase boundary
+ * costs one branch.
+ */
+enum { PHASE_EXTRACT, PHASE_CATEGORIZE, PHASE_SORT, PHASE_OUTPUT, PHASE_COUNT };
+#define HW_SLOT_FETCH PHASE_COUNT
+static const char *k_phase_names[PHASE_COUNT] = {"extract", "categorize", "sort", "output"};
+
+/* Transfer timings from curl_easy_getinfo, converted to per-step milliseconds. */
+typedef struct {
+    double dns_ms;
+    double connect_ms;
+    double tls_ms;
+    double ttfb_ms;         /* request start to first byte */
+    double transfer_ms;     /* first byte to done */
+    double total_ms;
+    double bytes;
+    long status;
+    long new_conns;         /* connections opened for this transfer, 0 = reused */
+    long http_version;      /* CURL_HTTP_VERSION_* actually used */
+    long redirects;         /* hops followed before the final response */
+    double redirect_ms;     /* time spent in them */
+} FetchStats;
+
+/* One response in a redirect chain: the URL requested, its status, and the time to its headers. */
+typedef struct {
+    char *url;
+    long status;
+    double ms;
+} RedirectHop;
+
+typedef struct {
+    RedirectHop *hops;      /* first = requested URL, last = final URL */
+    size_t count;
+    size_t cap;
+    double mark;            /* when the previous hop's headers arrived */
+} RedirectChain;
+
+typedef struct {
+    int enabled;
+    int trace;              /* emit phase spans (--trace) */
+    FetchStats fetch;       /* summed over pages in a batch */
+    size_t pages;
+    double run_wall_ms;     /* whole batch, 0 for a single page */
+    double wall_ms[PHASE_COUNT];
+    double cpu_ms[PHASE_COUNT];
+    double mark_wall;
+    double mark_cpu;
+    int hw;                 /* perf counters opened */
+    HwSample hw_phase[PHASE_COUNT + 1];   /* last slot: fetch wait */
+    size_t bytes;
+    size_t urls_found;
+    size_t urls_unique;
+    size_t urls_kept;
+    size_t conns_opened;    /* batch connection reuse (--stats) */
+    size_t conns_reused;
+    size_t h2_transfers;
+    double handshake_ms;    /* connect + TLS time of the opened connections */
+    size_t redirects;       /* hops followed, summed over pages */
+    size_t redirected_pages;
+    double redirect_ms;
+    const RedirectChain *chain;     /* single page: hops listed by --stats */
+} RunStats;
+
+static double mono_ms(void) {
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+    if (!freq.QuadPart) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (double)now.QuadPart * 1000.0 / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+#endif
+}
+
+static double cpu_ms(void) {
+#ifdef _WIN32
+    FILETIME c, e, k, u;
+    if (!GetProcessTimes(GetCurrentProcess(), &c, &e, &k, &u)) return 0.0;
+    ULARGE_INTEGER uk, uu;
+    uk.LowPart = k.dwLowDateTime; uk.HighPart = k.dwHighDateTime;
+    uu.LowPart = u.dwLowDateTime; uu.HighPart = u.dwHighDateTime;
+    return (double)(uk.QuadPart + uu.QuadPart) / 10000.0;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+#endif
+}
+
+static void trace_span(const char *cat, const char *name, double start_ms, double end_ms, const char *detail);
+
+static void stats_phase_begin(RunStats *rs) {
+    if (!rs->enabled && !rs->trace) return;
+    rs->mark_wall = mono_ms();
+    if (rs->enabled) rs->mark_cpu = cpu_ms();
+    if (rs->hw) hw_begin();
+}
+
+static void stats_phase_end(RunStats *rs, int phase) {
+    if (!rs->enabled && !rs->trace) return;
+    if (rs->hw) hw_end(&rs->hw_phase[phase]);
+    double now = mono_ms();
+    if (rs->trace) trace_span("parse", k_phase_names[phase], rs->mark_wall, now, NULL);
+    if (!rs->enabled) return;
+    rs->wall_ms[phase] += now - rs->mark_wall;
+    rs->cpu_ms[phase] += cpu_ms() - rs->mark_cpu;
+}
+
+/* Handshakes seen by the -DKNO_TLS_RESUME hook; stay 0 in other builds. */
+static atomic_ulong g_tls_full = 0;
+static atomic_ulong g_tls_resumed = 0;
+
+static void tls_counts_reset(void) {
+    atomic_store(&g_tls_full, 0);
+    atomic_store(&g_tls_resumed, 0);
+}
+
+static int cmp_str_ptr(const void *a, const void *b) {
+    return strcmp(*(const char * const *)a, *(const char * const *)b);
+}
+
+static size_t count_unique(char **items, size_t n) {
+    if (n == 0) return 0;
+    char **copy = (char **)kno_malloc(n * sizeof(char *));
+    if (!copy) return 0;
+    memcpy(copy, items, n * sizeof(char *));
+    qsort(copy, n, sizeof(char *), cmp_str_ptr);
+    size_t uniq = 1;
+    for (size_t i = 1; i < n; i++) {
+        if (strcmp(copy[i - 1], copy[i]) != 0) uniq++;
+    }
+    kno_free(copy);
+    return uniq;
+}
+
+static void stats_print_fetch(const FetchStats *fs) {
+    printf("[*] fetch: status %ld, dns %.2f ms, connect %.2f ms, tls %.2f ms, ttfb %.2f ms, transfer %.2f ms, total %.2f ms\n",
+           fs->status, fs->dns_ms, fs->connect_ms, fs->tls_ms, fs->ttfb_ms, fs->transfer_ms, fs->total_ms);
+    if (fs->redirects > 0) {
+        printf("[*] redirects: %ld followed, %.2f ms before the final request\n", fs->redirects, fs->redirect_ms);
+    }
+}
+
+/* Per-hop time is from the previous hop's response headers (or the start) to this one's. */
+static void stats_print_hops(const RedirectChain *c) {
+    if (!c || c->count < 2) return;
+    for (size_t i = 0; i < c->count; i++) {
+        printf("[*]   hop %zu: HTTP %ld %9.2f ms  %s\n", i, c->hops[i].status, c->hops[i].ms, c->hops[i].url);
+    }
+}
+
+static void stats_add_fetch(RunStats *rs, const FetchStats *fs) {
+    rs->fetch.dns_ms += fs->dns_ms;
+    rs->fetch.connect_ms += fs->connect_ms;
+    rs->fetch.tls_ms += fs->tls_ms;
+    rs->fetch.ttfb_ms += fs->ttfb_ms;
+    rs->fetch.transfer_ms += fs->transfer_ms;
+    rs->fetch.total_ms += fs->total_ms;
+    rs->fetch.bytes += fs->bytes;
+    rs->fetch.status = fs->status;
+    rs->pages++;
+    if (fs->new_conns > 0) {
+        rs->conns_opened += (size_t)fs->new_conns;
+        rs->handshake_ms += fs->connect_ms + fs->tls_ms;
+    } else {
+        rs->conns_reused++;
+    }
+    if (fs->http_version >= CURL_HTTP_VERSION_2_0) rs->h2_transfers++;
+    if (fs->redirects > 0) {
+        rs->redirects += (size_t)fs->redirects;
+        rs->redirected_pages++;
+        rs->redirect_ms += fs->redirect_ms;
+    }
+}
+
+static void stats_print(const RunStats *rs) {
+    double proc_wall = 0.0, proc_cpu = 0.0;
+
+    printf("[*] --stats\n");
+    if (rs->pages > 1) {
+        double n = (double)rs->pages;
+        printf("[*] fetch (mean of %zu): dns %.2f ms, connect %.2f ms, tls %.2f ms, ttfb %.2f ms, transfer %.2f ms, total %.2f ms\n",
+               rs->pages, rs->fetch.dns_ms / n, rs->fetch.connect_ms / n, rs->fetch.tls_ms / n,
+               rs->fetch.ttfb_ms / n, rs->fetch.transfer_ms / n, rs->fetch.total_ms / n);
+    } else {
+        stats_print_fetch(&rs->fetch);
+        stats_print_hops(rs->chain);
+    }
+    unsigned long tls_full = atomic_load(&g_tls_full), tls_resumed = atomic_load(&g_tls_resumed);
+    if (tls_full + tls_resumed > 0) {
+        printf("[*] tls handshakes %lu: %lu resumed, %lu full (%.0f%% resumed)\n",
+               tls_full + tls_resumed, tls_resumed, tls_full,
+               100.0 * (double)tls_resumed / (double)(tls_full + tls_resumed));
+    }
+    for (int ph = 0; ph < PHASE_COUNT; ph++) {
+        printf("[*] %-10s wall %8.3f ms  cpu %8.3f ms\n", k_phase_names[ph], rs->wall_ms[ph], rs->cpu_ms[ph]);
+        proc_wall += rs->wall_ms[ph];
+        proc_cpu += rs->cpu_ms[ph];
+    }
+    printf("[*] processing wall %.3f ms, cpu %.3f ms\n", proc_wall, proc_cpu);
+    printf("[*] bytes %zu, urls found %zu, unique %zu, kept %zu\n",
+           rs->bytes, rs->urls_found, rs->urls_unique, rs->urls_kept);
+    if (proc_wall > 0.0) {
+        printf("[*] throughput %.0f URLs/s, %.2f MB/s (extract %.2f MB/s)\n",
+               (double)rs->urls_found * 1000.0 / proc_wall,
+               (double)rs->bytes / 1e6 * 1000.0 / proc_wall,
+               rs->wall_ms[PHASE_EXTRACT] > 0.0 ? (double)rs->bytes / 1e6 * 1000.0 / rs->wall_ms[PHASE_EXTRACT] : 0.0);
+    }
+    if (rs->run_wall_ms > 0.0) {
+        printf("[*] batch wall %.3f ms, %zu pages, %.1f pages/s, %.0f URLs/s, %.2f MB/s\n",
+               rs->run_wall_ms, rs->pages,
+               (double)rs->pages * 1000.0 / rs->run_wall_ms,
+               (double)rs->urls_found * 1000.0 / rs->run_wall_ms,
+               rs->fetch.bytes / 1e6 * 1000.0 / rs->run_wall_ms);
+        /* Each reused transfer skipped one handshake; price it at the mean of the real ones. */
+        double per_conn = rs->conns_opened ? rs->handshake_ms / (double)rs->conns_opened : 0.0;
+        printf("[*] connections %zu opened for %zu transfers (%zu reused, %zu over HTTP/2), handshakes %.3f ms, ~%.3f ms saved\n",
+               rs->conns_opened, rs->pages, rs->conns_reused, rs->h2_transfers,
+               rs->handshake_ms, per_conn * (double)rs->conns_reused);
+        if (rs->redirects > 0) {
+            printf("[*] redirects %zu followed on %zu pages, %.3f ms (%.1f%% of fetch time)\n",
+                   rs->redirects, rs->redirected_pages, rs->redirect_ms,
+                   rs->fetch.total_ms > 0.0 ? 100.0 * rs->redirect_ms / rs->fetch.total_ms : 0.0);
+        }
+    }
+    if (rs->hw) {
+        static const char *labels[PHASE_COUNT + 1] = {"extract", "categorize", "sort", "output", "fetch wait"};
+        printf("[*] %-10s %14s %14s %6s %12s %12s\n", "hw", "cycles", "instructions", "IPC", "cache-miss", "branch-miss");
+        for (int ph = 0; ph <= PHASE_COUNT; ph++) {
+            const HwSample *h = &rs->hw_phase[ph];
+            char cm[24], bm[24];
+            if (hw_have(HW_CACHE_MISSES)) snprintf(cm, sizeof(cm), "%llu", (unsigned long long)h->v[HW_CACHE_MISSES]);
+            else snprintf(cm, sizeof(cm), "n/a");
+            if (hw_have(HW_BRANCH_MISSES)) snprintf(bm, sizeof(bm), "%llu", (unsigned long long)h->v[HW_BRANCH_MISSES]);
+            else snprintf(bm, sizeof(bm), "n/a");
+            printf("[*] %-10s %14llu %14llu %6.2f %12s %12s\n", labels[ph],
+                   (unsigned long long)h->v[HW_CYCLES], (unsigned long long)h->v[HW_INSTRUCTIONS],
+                   h->v[HW_CYCLES] ? (double)h->v[HW_INSTRUCTIONS] / (double)h->v[HW_CYCLES] : 0.0, cm, bm);
+        }
+    }
+#ifndef _WIN32
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) == 0) {
+#ifdef __APPLE__
+        printf("[*] peak RSS %.1f MiB\n", (double)ru.ru_maxrss / (1024.0 * 1024.0));
+#else
+        printf("[*] peak RSS %.1f MiB\n", (double)ru.ru_maxrss / 1024.0);
+#endif
+    }
+#endif
+    mem_print();
+}
+
+/* ---------- Trace export (--trace) ---------- */
+/*
+ * Chrome trace-event JSON ("X" complete events) for Perfetto / chrome://tracing.
+ * Each thread appends to its own fixed-size ring (oldest events are
+ * overwritten when it fills up); rings are only walked when the file is
+ * written at the end of the command.
+ */
+#define TRACE_RING_EVENTS 16384
+#define TRACE_DETAIL_MAX 120
+
+typedef struct {
+    const char *cat;
+    const char *name;
+    double ts_us;
+    double dur_us;
+    char detail[TRACE_DETAIL_MAX];
+} TraceEvent;
+
+typedef struct TraceRing {
+    TraceEvent *events;
+    size_t written;
+    int tid;
+    struct TraceRing *next;
+} TraceRing;
+
+static TraceRing *_Atomic g_trace_rings = NULL;
+static _Thread_local TraceRing *t_trace = NULL;
+static atomic_int g_trace_next_tid = 1;
+static atomic_int g_trace_on = 0;
+static double g_trace_t0 = 0.0;
+
+static void trace_begin(void) {
+    for (TraceRing *r = atomic_load(&g_trace_rings); r; r = r->next) r->written = 0;
+    g_trace_t0 = mono_ms();
+    atomic_store(&g_trace_on, 1);
+}
+
+/* Record a span [start_ms, end_ms) on the monotonic clock. detail may be NULL. */
+static void trace_span(const char *cat, const char *name, double start_ms, double end_ms, const char *detail) {
+    if (!atomic_load_explicit(&g_trace_on, memory_order_relaxed)) return;
+    if (!t_trace) {
+        TraceRing *r = (TraceRing *)kno_calloc(1, sizeof(TraceRing));
+        if (!r) return;
+        r->events = (TraceEvent *)kno_malloc(TRACE_RING_EVENTS * sizeof(TraceEvent));
+        if (!r->events) {
+            kno_free(r);
+            return;
+        }
+        r->tid = atomic_fetch_add(&g_trace_next_tid, 1);
+        TraceRing *head = atomic_load_explicit(&g_trace_rings, memory_order_relaxed);
+        do {
+            r->next = head;
+        } while (!atomic_compare_exchange_weak_explicit(&g_trace_rings, &head, r,
+                                                        memory_order_release, memory_order_relaxed));
+        t_trace = r;
+    }
+    TraceEvent *ev = &t_trace->events[t_trace->written % TRACE_RING_EVENTS];
+    ev->cat = cat;
+    ev->name = name;
+    ev->ts_us = (start_ms - g_trace_t0) * 1000.0;
+    ev->dur_us = end_ms > start_ms ? (end_ms - start_ms) * 1000.0 : 0.0;
+    if (detail) {
+        strncpy(ev->detail, detail, TRACE_DETAIL_MAX - 1);
+        ev->detail[TRACE_DETAIL_MAX - 1] = '\0';
+    } else {
+        ev->detail[0] = '\0';
+    }
+    t_trace->written++;
+}
+
+/* Spans for one transfer that started at start_ms, from its curl timings. */
+static void trace_fetch(const char *url, double start_ms, const FetchStats *fs) {
+    double dns_end = start_ms + fs->dns_ms;
+    double conn_end = dns_end + fs->connect_ms;
+    double tls_end = conn_end + fs->tls_ms;
+    double first_byte = start_ms + fs->ttfb_ms;
+
+    trace_span("net", "fetch", start_ms, start_ms + fs->total_ms, url);
+    if (fs->dns_ms > 0.0) trace_span("net", "dns", start_ms, dns_end, NULL);
+    if (fs->connect_ms > 0.0) trace_span("net", "connect", dns_end, conn_end, NULL);
+    if (fs->tls_ms > 0.0) trace_span("net", "tls", conn_end, tls_end, NULL);
+    trace_span("net", "wait", tls_end, first_byte, NULL);
+    trace_span("net", "transfer", first_byte, first_byte + fs->transfer_ms, NULL);
+}
+
+static void json_write_escaped(FILE *f, const char *s) {
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') fprintf(f, "\\%c", c);
+        else if (c < 0x20) fprintf(f, "\\u%04x", c);
+        else fputc(c, f);
+    }
+}
+
+/* Stop recording and write every ring to path. */
+static void trace_write(const char *path) {
+    atomic_store(&g_trace_on, 0);
+    FILE *f = fopen(path, "w");
+    size_t total = 0, dropped = 0;
+    if (!f) {
+        fprintf(stderr, "[-] Failed to write to %s\n", path);
+        return;
+    }
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", f);
+    fputs("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"kno-url\"}}", f);
+    for (TraceRing *r = atomic_load(&g_trace_rings); r; r = r->next) {
+        size_t n = r->written < TRACE_RING_EVENTS ? r->written : TRACE_RING_EVENTS;
+        size_t first = r->written - n;
+        if (r->written == 0) continue;
+        fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}",
+                r->tid, r->tid);
+        for (size_t i = first; i < r->written; i++) {
+            const TraceEvent *ev = &r->events[i % TRACE_RING_EVENTS];
+            fprintf(f, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d",
+                    ev->name, ev->cat, ev->ts_us, ev->dur_us, r->tid);
+            if (ev->detail[0]) {
+                fputs(",\"args\":{\"url\":\"", f);
+                json_write_escaped(f, ev->detail);
+                fputs("\"}", f);
+            }
+            fputc('}', f);
+        }
+        total += n;
+        dropped += first;
+    }
+    fputs("\n]}\n", f);
+    fclose(f);
+    if (dropped) {
+        printf("[*] Trace written to %s (%zu events, %zu oldest dropped)\n", path, total, dropped);
+    } else {
+        printf("[*] Trace written to %s (%zu events)\n", path, total);
+    }
+}
+
+/* ---------- HTTP fetch via libcurl ---------- */
+struct MemoryBuffer {
+    char *data;
+    size_t size;
+};
+
+static size_t write_callback(void *contents, size_t size, size_t nmemb, void *userp) {
+    size_t realsize = size * nmemb;
+    struct MemoryBuffer *mem = (struct MemoryBuffer *)userp;
+
+    char *ptr = (char *)kno_realloc(mem->data, mem->size + realsize + 1);
+    if (!ptr) return 0;
+    mem->data = ptr;
+    memcpy(&(mem->data[mem->size]), contents, realsize);
+    mem->size += realsize;
+    mem->data[mem->size] = '\0';
+    return realsize;
+}
+
+/* ---------- URLs from response headers ---------- */
+/*
+ * Location, Content-Location, Link, Refresh, Access-Control-Allow-Origin and
+ * Content-Security-Policy often name endpoints and CDN hosts the body never
+ * mentions. The header callback picks them out line by line as the response
+ * arrives, resolving relative references against the URL being fetched; they
+ * are rendered with the page, tagged with the header they came from.
+ *
+ * The same callback sees each status line, so it also records the redirect
+ * chain libcurl follows: every hop's URL, status and time to its headers.
+ * Hops after the first are added to the page's URLs, tagged with their status.
+ */
+#define FETCH_MAX_REDIRS 10
+
+typedef struct {
+    CURL *easy;
+    StrList urls;
+    StrList names;          /* output tag per URL: "header: link", "redirect: HTTP 302" */
+    int header_urls;        /* also take URLs from header lines (off with --no-header-urls) */
+    long max_redirs;        /* 0 = do not follow */
+    RedirectChain chain;
+} HeaderUrls;
+
+static void header_urls_init(HeaderUrls *h) {
+    memset(h, 0, sizeof(*h));
+    sl_init(&h->urls);
+    sl_init(&h->names);
+    h->header_urls = 1;
+    h->max_redirs = FETCH_MAX_REDIRS;
+}
+
+static void header_urls_free(HeaderUrls *h) {
+    sl_free(&h->urls);
+    sl_free(&h->names);
+    for (size_t i = 0; i < h->chain.count; i++) kno_free(h->chain.hops[i].url);
+    kno_free(h->chain.hops);
+    h->chain.hops = NULL;
+    h->chain.count = h->chain.cap = 0;
+}
+
+/* Forget what a failed attempt recorded, keeping the settings, before it is retried. */
+static void header_urls_reset(HeaderUrls *h) {
+    int header_urls = h->header_urls;
+    long max_redirs = h->max_redirs;
+    header_urls_free(h);
+    header_urls_init(h);
+    h->header_urls = header_urls;
+    h->max_redirs = max_redirs;
+}
+
+/* Add url with its tag; replace keeps the URL but takes the new tag if it is already listed. */
+static void header_url_tag(HeaderUrls *h, const char *url, const char *tag, int replace) {
+    if (strncmp(url, "http://", 7) != 0 && strncmp(url, "https://", 8) != 0) return;
+    for (size_t i = 0; i < h->urls.count; i++) {
+        if (strcmp(h->urls.items[i], url) != 0) continue;
+        if (replace) {
+            char *t = kno_strdup(tag);
+            if (t) {
+                kno_free(h->names.items[i]);
+                h->names.items[i] = t;
+            }
+        }
+        return;
+    }
+    sl_add(&h->urls, url);
+    sl_add(&h->names, tag);
+}
+
+static void header_url_keep(HeaderUrls *h, const char *name, const char *url) {
+    char tag[64];
+    snprintf(tag, sizeof(tag), "header: %s", name);
+    header_url_tag(h, url, tag, 0);
+}
+
+/* A status line: start a new hop at the transfer's current URL (1xx interim responses are skipped). */
+static void header_status(HeaderUrls *h, const char *line, size_t n) {
+    const char *sp = memchr(line, ' ', n);
+    char *url = NULL, tag[48];
+    long status;
+    double now = mono_ms();
+    RedirectChain *c = &h->chain;
+
+    if (!sp) return;
+    status = strtol(sp + 1, NULL, 10);
+    if (status < 200) return;
+    curl_easy_getinfo(h->easy, CURLINFO_EFFECTIVE_URL, &url);
+    if (!url) return;
+    if (c->count > 0 && strcmp(c->hops[c->count - 1].url, url) == 0) return;   /* proxy CONNECT */
+    if (c->count == c->cap) {
+        size_t cap = c->cap ? c->cap * 2 : 4;
+        RedirectHop *hops = (RedirectHop *)kno_realloc(c->hops, cap * sizeof(RedirectHop));
+        if (!hops) return;
+        c->hops = hops;
+        c->cap = cap;
+    }
+    c->hops[c->count].url = kno_strdup(url);
+    if (!c->hops[c->count].url) return;
+    c->hops[c->count].status = status;
+    c->hops[c->count].ms = now - c->mark;
+    c->mark = now;
+    if (c->count++ > 0) {
+        snprintf(tag, sizeof(tag), "redirect: HTTP %ld", status);
+        header_url_tag(h, url, tag, 1);
+    }
+}
+
+/* A URL reference, possibly relative to the transfer's current URL. */
+static void header_url_ref(HeaderUrls *h, const char *name, const char *ref, size_t len) {
+    char buf[2048];
+    char *base = NULL, *abs = NULL;
+    CURLU *u;
+
+    if (len == 0 || len >= sizeof(buf)) return;
+    memcpy(buf, ref, len);
+    buf[len] = '\0';
+    if (!(u = curl_url())) return;
+    curl_easy_getinfo(h->easy, CURLINFO_EFFECTIVE_URL, &base);
+    if (base) curl_url_set(u, CURLUPART_URL, base, 0);
+    /* With a base set, curl_url_set resolves a relative reference against it. */
+    if (curl_url_set(u, CURLUPART_URL, buf, 0) == CURLUE_OK &&
+        curl_url_get(u, CURLUPART_URL, &abs, 0) == CURLUE_OK) {
+        header_url_keep(h, name, abs);
+    }
+    curl_free(abs);
+    curl_url_cleanup(u);
+}
+
+/*
+ * CSP sources: full URLs and host sources (cdn.example.com, *.example.com:443); report-uri paths.
+ * Wildcards are reduced to a fetchable URL: "*.example.com" becomes its base host, ":*" is dropped.
+ */
+static void header_csp(HeaderUrls *h, const char *name, const char *v, const char *end) {
+    char tok[1024];
+    int first = 1, report_uri = 0;
+
+    while (v < end) {
+        if (*v == ';') {
+            first = 1;
+            v++;
+            continue;
+        }
+        if (isspace((unsigned char)*v)) {
+            v++;
+            continue;
+        }
+        const char *s = v;
+        while (v < end && *v != ';' && !isspace((unsigned char)*v)) v++;
+        size_t n = (size_t)(v - s);
+        if (first) {
+            report_uri = n == 10 && memcmp(s, "report-uri", 10) == 0;
+            first = 0;
+            continue;
+        }
+        if (*s == '\'' || n + 9 >= sizeof(tok)) continue;     /* 'self', 'nonce-...' */
+        if (report_uri && *s == '/') {
+            header_url_ref(h, name, s, n);
+            continue;
+        }
+        memcpy(tok, s, n);
+        tok[n] = '\0';
+        char *host = strstr(tok, "://");
+        host = host ? host + 3 : tok;
+        if (strncmp(host, "*.", 2) == 0) memmove(host, host + 2, strlen(host + 2) + 1);
+        char *port = strstr(host, ":*");
+        if (port) memmove(port, port + 2, strlen(port + 2) + 1);
+        n = strlen(tok);
+        if (strchr(tok, '*')) continue;
+        if (strstr(tok, "://")) {
+            header_url_keep(h, name, tok);
+        } else if (memchr(tok, '.', n) && (!strchr(tok, ':') || strchr(tok, '.') < strchr(tok, ':'))) {
+            char full[1040];
+            snprintf(full, sizeof(full), "https://%s", tok);
+            header_url_keep(h, name, full);
+        }
+    }
+}
+
+static size_t header_callback(char *buf, size_t size, size_t nitems, void *userp) {
+    HeaderUrls *h = (HeaderUrls *)userp;
+    size_t n = size * nitems, i = 0;
+    char name[48];
+
+    if (n > 5 && memcmp(buf, "HTTP/", 5) == 0) {
+        header_status(h, buf, n);
+        return n;
+    }
+    if (!h->header_urls) return n;
+    while (i < n && buf[i] != ':' && i + 1 < sizeof(name)) {
+        name[i] = (char)tolower((unsigned char)buf[i]);
+        i++;
+    }
+    if (i == n || buf[i] != ':') return n;
+    name[i] = '\0';
+    const char *v = buf + i + 1, *end = buf + n;
+    while (v < end && isspace((unsigned char)*v)) v++;
+    while (end > v && isspace((unsigned char)end[-1])) end--;
+    if (v == end) return n;
+
+    if (strcmp(name, "location") == 0 || strcmp(name, "content-location") == 0) {
+        header_url_ref(h, name, v, (size_t)(end - v));
+    } else if (strcmp(name, "link") == 0) {
+        /* <uri>; rel=preload, <uri2>; rel=modulepreload */
+        for (const char *p = v; (p = memchr(p, '<', (size_t)(end - p))) != NULL; ) {
+            const char *q = memchr(p, '>', (size_t)(end - p));
+            if (!q) break;
+            header_url_ref(h, name, p + 1, (size_t)(q - p - 1));
+            p = q + 1;
+        }
+    } else if (strcmp(name, "refresh") == 0) {
+        /* 5; url=/next */
+        for (const char *p = v; p + 4 <= end; p++) {
+            if (tolower((unsigned char)p[0]) == 'u' && tolower((unsigned char)p[1]) == 'r' &&
+                tolower((unsigned char)p[2]) == 'l' && p[3] == '=') {
+                const char *s = p + 4, *e = end;
+                if (s < e && (*s == '\'' || *s == '"')) {
+                    s++;
+                    if (e > s && e[-1] == s[-1]) e--;
+                }
+                header_url_ref(h, name, s, (size_t)(e - s));
+                break;
+            }
+        }
+    } else if (strcmp(name, "access-control-allow-origin") == 0) {
+        if (!(end - v == 1 && *v == '*') && !(end - v == 4 && memcmp(v, "null", 4) == 0)) {
+            header_url_ref(h, name, v, (size_t)(end - v));
+        }
+    } else if (strcmp(name, "content-security-policy") == 0 ||
+               strcmp(name, "content-security-policy-report-only") == 0) {
+        header_csp(h, name, v, end);
+    }
+    return n;
+}
+
+/* Follow up to max_redirs redirects (0 = report the 3xx itself). fetch_setup_easy leaves this to the caller. */
+static void fetch_setup_redirects(CURL *curl, long max_redirs) {
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, max_redirs > 0 ? 1L : 0L);
+    curl_easy_setopt(curl, CURLOPT_MAXREDIRS, max_redirs);
+}
+
+/* Collect header URLs and the redirect chain of the transfer on curl into h, following up to h->max_redirs. */
+static void fetch_collect_headers(CURL *curl, HeaderUrls *h) {
+    h->easy = curl;
+    h->chain.mark = mono_ms();
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, header_callback);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, (void *)h);
+    fetch_setup_redirects(curl, h->max_redirs);
+}
+
+/* Fill fs (if non-NULL) from a finished transfer. */
+static void fetch_collect_stats(CURL *curl, FetchStats *fs) {
+    curl_off_t dns = 0, conn = 0, app = 0, start = 0, total = 0, bytes = 0, redir = 0;
+
+    curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME_T, &dns);
+    curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &conn);
+    curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &app);
+    curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &start);
+    curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &total);
+    curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &bytes);
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &fs->status);
+    curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &fs->new_conns);
+    curl_easy_getinfo(curl, CURLINFO_HTTP_VERSION, &fs->http_version);
+    curl_easy_getinfo(curl, CURLINFO_REDIRECT_COUNT, &fs->redirects);
+    curl_easy_getinfo(curl, CURLINFO_REDIRECT_TIME_T, &redir);
+
+    /* libcurl reports cumulative microseconds since the transfer started. */
+    fs->dns_ms = (double)dns / 1000.0;
+    fs->connect_ms = conn > dns ? (double)(conn - dns) / 1000.0 : 0.0;
+    fs->tls_ms = app > conn ? (double)(app - conn) / 1000.0 : 0.0;
+    /* STARTTRANSFER counts from the first hop; ttfb is the final request's own. */
+    fs->ttfb_ms = start > redir ? (double)(start - redir) / 1000.0 : 0.0;
+    fs->transfer_ms = total > start ? (double)(total - start) / 1000.0 : 0.0;
+    fs->total_ms = (double)total / 1000.0;
+    fs->bytes = (double)bytes;
+    fs->redirect_ms = (double)redir / 1000.0;
+}
+
+/* ---------- Retry scheduling ---------- */
+/*
+ * Transient failures (timeouts, refused or reset connections, 429, 502-504)
+ * are retried with exponential backoff and full jitter, or after the
+ * server's Retry-After. The batch and --serve engines park waiting transfers
+ * in a min-heap keyed by due time, restart the due ones on each pass and cap
+ * their poll timeout at the earliest, so a retry never holds a thread.
+ *
+ * A token bucket keeps retries to a fraction of the request rate: every
+ * first attempt earns `ratio` tokens, a retry spends one, and the bucket
+ * starts full and holds at most RETRY_RESERVE. A run of N first attempts
+ * therefore makes at most ratio * N + RETRY_RESERVE retries: the reserve
+ * lets a short run or a single page retry at all, and over a long outage
+ * the extra load tends to `ratio`.
+ */
+#define RETRY_DEFAULT 3
+#define RETRY_DEFAULT_RATIO 0.1
+#define RETRY_BASE_MS 500.0
+#define RETRY_CAP_MS 30000.0
+#define RETRY_AFTER_MAX_MS 120000.0     /* longer Retry-After values are clamped */
+#define RETRY_RESERVE 10.0
+
+typedef struct {
+    long max_retries;       /* per transfer, 0 = never */
+    double ratio;           /* tokens earned per first attempt */
+    double tokens;
+    uint64_t rng;
+    size_t scheduled;
+    size_t denied;          /* transient failures the budget turned away */
+} RetryPolicy;
+
+typedef struct {
+    double due_ms;
+    void *job;
+} RetryTimer;
+
+typedef struct {
+    RetryTimer *items;
+    size_t count;
+    size_t cap;
+} RetryHeap;
+
+static void retry_policy_init(RetryPolicy *p, long max_retries, double ratio) {
+    memset(p, 0, sizeof(*p));
+    p->max_retries = max_retries;
+    p->ratio = ratio;
+    p->tokens = RETRY_RESERVE;
+    p->rng = (uint64_t)(mono_ms() * 1000.0) | 1;
+}
+
+static void retry_earn(RetryPolicy *p) {
+    p->tokens += p->ratio;
+    if (p->tokens > RETRY_RESERVE) p->tokens = RETRY_RESERVE;
+}
+
+static int retry_transient(CURLcode res, long status) {
+    switch (res) {
+    case CURLE_OK:
+        return status == 429 || status == 502 || status == 503 || status == 504;
+    case CURLE_COULDNT_CONNECT:
+    case CURLE_OPERATION_TIMEDOUT:
+    case CURLE_SEND_ERROR:
+    case CURLE_RECV_ERROR:
+    case CURLE_GOT_NOTHING:
+    case CURLE_PARTIAL_FILE:
+    case CURLE_HTTP2:
+    case CURLE_HTTP2_STREAM:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/*
+ * Delay in ms before retry number `attempt` (1-based) of the transfer that
+ * just finished on easy, or -1 if it is not retried. A retry spends a token.
+ */
+static double retry_plan(RetryPolicy *p, CURL *easy, CURLcode res, int attempt) {
+    long status = 0;
+    if (res == CURLE_OK) curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &status);
+    if (attempt > p->max_retries || !retry_transient(res, status)) return -1.0;
+    if (p->tokens < 1.0) {
+        p->denied++;
+        return -1.0;
+    }
+    p->tokens -= 1.0;
+    p->scheduled++;
+#if LIBCURL_VERSION_NUM >= 0x074200
+    curl_off_t after = 0;
+    if (curl_easy_getinfo(easy, CURLINFO_RETRY_AFTER, &after) == CURLE_OK && after > 0) {
+        double ms = (double)after * 1000.0;
+        return ms < RETRY_AFTER_MAX_MS ? ms : RETRY_AFTER_MAX_MS;
+    }
+#endif
+    double ceiling = RETRY_BASE_MS * (double)(1UL << (attempt < 16 ? attempt - 1 : 15));
+    if (ceiling > RETRY_CAP_MS) ceiling = RETRY_CAP_MS;
+    /* Full jitter (uniform below the ceiling) so transfers that failed together spread out. */
+    p->rng ^= p->rng << 13;
+    p->rng ^= p->rng >> 7;
+    p->rng ^= p->rng << 17;
+    return ceiling * (double)(p->rng >> 11) / 9007199254740992.0;
+}
+
+static int retry_heap_push(RetryHeap *h, double due_ms, void *job) {
+    if (h->count == h->cap) {
+        size_t cap = h->cap ? h->cap * 2 : 16;
+        RetryTimer *items = (RetryTimer *)kno_realloc(h->items, cap * sizeof(RetryTimer));
+        if (!items) return 0;
+        h->items = items;
+        h->cap = cap;
+    }
+    size_t i = h->count++;
+    while (i > 0) {
+        size_t up = (i - 1) / 2;
+        if (h->items[up].due_ms <= due_ms) break;
+        h->items[i] = h->items[up];
+        i = up;
+    }
+    h->items[i].due_ms = due_ms;
+    h->items[i].job = job;
+    return 1;
+}
+
+/* The earliest parked job if it is due at now, else NULL. */
+static void *retry_heap_pop_due(RetryHeap *h, double now) {
+    if (h->count == 0 || h->items[0].due_ms > now) return NULL;
+    void *job = h->items[0].job;
+    RetryTimer last = h->items[--h->count];
+    size_t i = 0;
+    for (;;) {
+        size_t c = 2 * i + 1;
+        if (c >= h->count) break;
+        if (c + 1 < h->count && h->items[c + 1].due_ms < h->items[c].due_ms) c++;
+        if (last.due_ms <= h->items[c].due_ms) break;
+        h->items[i] = h->items[c];
+        i = c;
+    }
+    if (h->count > 0) h->items[i] = last;
+    return job;
+}
+
+/* Poll timeout: max_ms, or less if a parked job falls due sooner. */
+static int retry_heap_wait_ms(const RetryHeap *h, int max_ms) {
+    if (h->count == 0) return max_ms;
+    double d = h->items[0].due_ms - mono_ms();
+    if (d <= 0.0) return 0;
+    return d < (double)max_ms ? (int)d + 1 : max_ms;
+}
+
+static void retry_heap_free(RetryHeap *h) {
+    kno_free(h->items);
+    memset(h, 0, sizeof(*h));
+}
+
+/* "HTTP 503" or the curl error, for retry notices. */
+static void retry_reason(CURL *easy, CURLcode res, const char *errbuf, char *buf, size_t cap) {
+    long status = 0;
+    if (res != CURLE_OK) {
+        snprintf(buf, cap, "%s", errbuf && errbuf[0] ? errbuf : curl_easy_strerror(res));
+        return;
+    }
+    curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &status);
+    snprintf(buf, cap, "HTTP %ld", status);
+}
+
+/* ---------- TLS session persistence (-DKNO_TLS_RESUME) ---------- */
+/*
+ * libcurl 7.x keeps TLS sessions only for the life of the process, so every
+ * run starts with full handshakes. Built with -DKNO_TLS_RESUME (link
+ * -lssl -lcrypto) against an OpenSSL-backed libcurl, each SSL_CTX libcurl
+ * creates is hooked: new sessions are kept per SNI host, offered on the next
+ * handshake to that host when libcurl's own cache has nothing, and written
+ * to .kno-url/tls-sessions (mode 0600) when the network layer shuts down.
+ */
+#if defined(KNO_TLS_RESUME) && !defined(_WIN32)
+#define TLS_MAX_SESSIONS 256
+
+typedef struct {
+    char host[256];
+    unsigned char *der;     /* i2d_SSL_SESSION */
+    int len;
+    long long expires;      /* unix time */
+} TlsSession;
+
+static TlsSession g_tls_sessions[TLS_MAX_SESSIONS];
+static size_t g_tls_nsessions = 0;
+static int g_tls_dirty = 0;
+static pthread_mutex_t g_tls_lock = PTHREAD_MUTEX_INITIALIZER;
+static int g_tls_hook = 0;                  /* libcurl's backend is OpenSSL */
+static int g_tls_ex_index = -1;             /* per-SSL "handshake counted" mark */
+static int (*g_tls_curl_new_cb)(SSL *, SSL_SESSION *) = NULL;
+
+static char *kno_state_path(const char *name);
+
+/* Store a session for host, taking ownership of der. */
+static void tls_store(const char *host, unsigned char *der, int len, long long expires) {
+    TlsSession *slot = NULL;
+    pthread_mutex_lock(&g_tls_lock);
+    for (size_t i = 0; i < g_tls_nsessions && !slot; i++) {
+        if (strcmp(g_tls_sessions[i].host, host) == 0) slot = &g_tls_sessions[i];
+    }
+    if (!slot && g_tls_nsessions < TLS_MAX_SESSIONS) slot = &g_tls_sessions[g_tls_nsessions++];
+    if (!slot) {
+        /* Full: replace the session that expires first. */
+        slot = &g_tls_sessions[0];
+        for (size_t i = 1; i < g_tls_nsessions; i++) {
+            if (g_tls_sessions[i].expires < slot->expires) slot = &g_tls_sessions[i];
+        }
+    }
+    kno_free(slot->der);
+    snprintf(slot->host, sizeof(slot->host), "%s", host);
+    slot->der = der;
+    slot->len = len;
+    slot->expires = expires;
+    g_tls_dirty = 1;
+    pthread_mutex_unlock(&g_tls_lock);
+}
+
+static int tls_new_session(SSL *ssl, SSL_SESSION *sess) {
+    const char *host = SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name);
+    if (host && strlen(host) < sizeof(g_tls_sessions[0].host) && SSL_SESSION_is_resumable(sess)) {
+        int len = i2d_SSL_SESSION(sess, NULL);
+        unsigned char *der = len > 0 ? (unsigned char *)kno_malloc((size_t)len) : NULL;
+        if (der) {
+            unsigned char *p = der;
+            i2d_SSL_SESSION(sess, &p);
+            tls_store(host, der, len, (long long)SSL_SESSION_get_time(sess) + SSL_SESSION_get_timeout(sess));
+        }
+    }
+    /* libcurl's own callback keeps the in-process cache (and may keep a reference). */
+    return g_tls_curl_new_cb ? g_tls_curl_new_cb(ssl, sess) : 0;
+}
+
+static void tls_info(const SSL *ssl, int where, int ret) {
+    (void)ret;
+    /* TLS 1.3 post-handshake messages fire START/DONE again; only the first handshake counts. */
+    if ((where & SSL_CB_HANDSHAKE_START) && SSL_in_before(ssl) && !SSL_get_session(ssl)) {
+        const char *host = SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name);
+        SSL_SESSION *sess = NULL;
+        if (!host) return;
+        pthread_mutex_lock(&g_tls_lock);
+        for (size_t i = 0; i < g_tls_nsessions; i++) {
+            const TlsSession *t = &g_tls_sessions[i];
+            if (strcmp(t->host, host) == 0 && t->expires > (long long)time(NULL)) {
+                const unsigned char *p = t->der;
+                sess = d2i_SSL_SESSION(NULL, &p, t->len);
+                break;
+            }
+        }
+        pthread_mutex_unlock(&g_tls_lock);
+        if (sess) {
+            SSL_set_session((SSL *)ssl, sess);
+            SSL_SESSION_free(sess);
+        }
+    }
+    if ((where & SSL_CB_HANDSHAKE_DONE) && !SSL_get_ex_data(ssl, g_tls_ex_index)) {
+        SSL_set_ex_data((SSL *)ssl, g_tls_ex_index, (void *)1);
+        atomic_fetch_add(SSL_session_reused(ssl) ? &g_tls_resumed : &g_tls_full, 1);
+    }
+}
+
+static CURLcode tls_ctx_hook(CURL *curl, void *ctx, void *user) {
+    SSL_CTX *c = (SSL_CTX *)ctx;
+    int (*cb)(SSL *, SSL_SESSION *) = SSL_CTX_sess_get_new_cb(c);
+    (void)curl; (void)user;
+    if (cb != tls_new_session) {
+        if (cb) {
+            pthread_mutex_lock(&g_tls_lock);
+            g_tls_curl_new_cb = cb;
+            pthread_mutex_unlock(&g_tls_lock);
+        }
+        SSL_CTX_set_session_cache_mode(c, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL);
+        SSL_CTX_sess_set_new_cb(c, tls_new_session);
+    }
+    SSL_CTX_set_info_callback(c, tls_info);
+    return CURLE_OK;
+}
+
+static void tls_setup_easy(CURL *curl) {
+    if (g_tls_hook) curl_easy_setopt(curl, CURLOPT_SSL_CTX_FUNCTION, tls_ctx_hook);
+}
+
+/* Lines are "host expires base64(der)". */
+static void tls_resume_load(void) {
+    char *path = kno_state_path("tls-sessions");
+    FILE *f = path ? fopen(path, "r") : NULL;
+    static char line[16384];
+    char host[256];
+    long long expires, now = (long long)time(NULL);
+    int off;
+
+    kno_free(path);
+    if (!f) return;
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "%255s %lld %n", host, &expires, &off) != 2 || expires <= now) continue;
+        char *b64 = line + off;
+        size_t n = strcspn(b64, "\r\n");
+        if (n == 0 || n % 4) continue;
+        unsigned char *der = (unsigned char *)kno_malloc(n / 4 * 3);
+        if (!der) break;
+        int len = EVP_DecodeBlock(der, (const unsigned char *)b64, (int)n);
+        if (len < 0) {
+            kno_free(der);
+            continue;
+        }
+        len -= (b64[n - 1] == '=') + (b64[n - 2] == '=');
+        tls_store(host, der, len, expires);
+    }
+    fclose(f);
+    g_tls_dirty = 0;
+}
+
+/* Forgets every cached session so a later tls_resume_save has nothing to write. */
+static void tls_resume_discard(void) {
+    pthread_mutex_lock(&g_tls_lock);
+    for (size_t i = 0; i < g_tls_nsessions; i++) kno_free(g_tls_sessions[i].der);
+    g_tls_nsessions = 0;
+    g_tls_dirty = 0;
+    pthread_mutex_unlock(&g_tls_lock);
+}
+
+static void tls_resume_save(void) {
+    char *dir = kno_state_path(NULL);
+    char *path = kno_state_path("tls-sessions");
+    char *tmp = path ? (char *)kno_malloc(strlen(path) + 5) : NULL;
+    long long now = (long long)time(NULL);
+
+    if (g_tls_dirty && tmp) {
+        mkdir(dir, 0700);
+        sprintf(tmp, "%s.tmp", path);
+        int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        FILE *f = fd >= 0 ? fdopen(fd, "w") : NULL;
+        if (!f && fd >= 0) close(fd);
+        if (f) {
+            for (size_t i = 0; i < g_tls_nsessions; i++) {
+                const TlsSession *t = &g_tls_sessions[i];
+                char *b64 = t->expires > now ? (char *)kno_malloc((size_t)(t->len + 2) / 3 * 4 + 1) : NULL;
+                if (!b64) continue;
+                EVP_EncodeBlock((unsigned char *)b64, t->der, t->len);
+                fprintf(f, "%s %lld %s\n", t->host, t->expires, b64);
+                kno_free(b64);
+            }
+            if (fclose(f) != 0 || rename(tmp, path) != 0) remove(tmp);
+        }
+    }
+    tls_resume_discard();
+    kno_free(tmp);
+    kno_free(path);
+    kno_free(dir);
+}
+
+static void tls_resume_init(void) {
+    const curl_version_info_data *v = curl_version_info(CURLVERSION_NOW);
+    /* The SSL_CTX handed to the hook is only an OpenSSL one when libcurl uses OpenSSL. */
+    g_tls_hook = v->ssl_version && strncmp(v->ssl_version, "OpenSSL", 7) == 0;
+    if (!g_tls_hook) return;
+    g_tls_ex_index = SSL_get_ex_new_index(0, NULL, NULL, NULL, NULL);
+    tls_resume_load();
+}
+#else
+static void tls_setup_easy(CURL *curl) { (void)curl; }
+static void tls_resume_init(void) {}
+static void tls_resume_discard(void) {}
+static void tls_resume_save(void) {}
+#endif
+
+/*
+ * Time bounds for one transfer, in seconds (0 = no bound). A transfer that
+ * hits one fails with CURLE_OPERATION_TIMEDOUT, which the retry engine
+ * treats as transient. Besides these, a transfer that moves less than one
+ * byte per second for FETCH_STALL_SECONDS is abandoned the same way.
+ */
+#define FETCH_CONNECT_TIMEOUT 10
+#define FETCH_TIMEOUT 120
+#define FETCH_STALL_SECONDS 30
+
+typedef struct {
+    long connect_timeout;   /* TCP + TLS handshake */
+    long timeout;           /* whole transfer, redirects included */
+} FetchLimits;
+
+static const FetchLimits k_fetch_limits_default = { FETCH_CONNECT_TIMEOUT, FETCH_TIMEOUT };
+
+/* Options shared by every page fetch (single URL and batch). lim NULL = the defaults. */
+static void fetch_setup_easy(CURL *curl, const char *url, struct MemoryBuffer *chunk, const FetchLimits *lim) {
+    if (!lim) lim = &k_fetch_limits_default;
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_USERAGENT, "KNO-URL-C/1.0");
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)chunk);
+    if (g_accept_encoding) curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, g_accept_encoding);
+    /* Ignore SSL errors like Python version */
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+    if (g_hosts_map) curl_easy_setopt(curl, CURLOPT_RESOLVE, g_hosts_map);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, lim->connect_timeout);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, lim->timeout);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1L);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, (long)FETCH_STALL_SECONDS);
+    tls_setup_easy(curl);
+}
+
+/*
+ * Many batch targets share a host: offer HTTP/2 over TLS and let transfers
+ * wait for a connection they can multiplex on instead of each racing to open
+ * their own. Plain http:// and HTTP/1.1-only servers keep one transfer per
+ * connection, capped by host_conns (0 = no cap).
+ */
+static void fetch_setup_multi(CURLM *multi, long host_conns, long h2_streams) {
+    curl_multi_setopt(multi, CURLMOPT_PIPELINING, (long)CURLPIPE_MULTIPLEX);
+    if (host_conns > 0) curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, host_conns);
+#if LIBCURL_VERSION_NUM >= 0x074300
+    curl_multi_setopt(multi, CURLMOPT_MAX_CONCURRENT_STREAMS, h2_streams);
+#else
+    (void)h2_streams;
+#endif
+}
+
+static void fetch_setup_multiplexed(CURL *curl) {
+    curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS);
+    curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+}
+
+/*
+ * libcurl (and the TLS library behind it) is loaded and initialised on the
+ * first fetch, so --input and other offline commands never pay for it.
+ * Returns 0 if libcurl cannot be loaded.
+ */
+static int g_net_ready = 0;
+
+static int net_init(void) {
+    if (g_net_ready) return 1;
+    if (!curl_load()) return 0;
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    tls_resume_init();
+    g_net_ready = 1;
+    return 1;
+}
+
+static void net_cleanup(void) {
+    if (!g_net_ready) return;
+    tls_resume_save();
+    curl_global_cleanup();
+    g_net_ready = 0;
+}
+
+/*
+ * A single page waits out its retries in place: unlike the batch and --serve
+ * engines, this thread has no other transfers to drive meanwhile.
+ */
+static void retry_sleep_ms(double ms) {
+#ifdef _WIN32
+    Sleep((DWORD)ms);
+#else
+    struct timespec ts;
+    ts.tv_sec = (time_t)(ms / 1000.0);
+    ts.tv_nsec = (long)((ms - (double)ts.tv_sec * 1000.0) * 1e6);
+    nanosleep(&ts, NULL);
+#endif
+}
+
+/*
+ * hdr (if non-NULL) receives the URLs named in the response headers. retry
+ * (if non-NULL) decides whether and when a transient failure is retried.
+ * lim NULL uses the default time bounds.
+ */
+static char *fetch_html(const char *url, FetchStats *fs, HeaderUrls *hdr, RetryPolicy *retry,
+                        const FetchLimits *lim) {
+    CURL *curl;
+    CURLcode res;
+    struct MemoryBuffer chunk;
+    char errbuf[CURL_ERROR_SIZE];
+    chunk.data = NULL;
+    chunk.size = 0;
+
+    curl = net_init() ? curl_easy_init() : NULL;
+    if (!curl) {
+        fprintf(stderr, "[-] Failed to init CURL\n");
+        return NULL;
+    }
+
+    fetch_setup_easy(curl, url, &chunk, lim);
+    if (!hdr) fetch_setup_redirects(curl, FETCH_MAX_REDIRS);     /* else set with each attempt's headers */
+    curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, errbuf);
+    if (retry) retry_earn(retry);
+
+    for (int attempt = 1;; attempt++) {
+        errbuf[0] = '\0';
+        if (hdr) fetch_collect_headers(curl, hdr);
+        mem_phase(MEM_FETCH);
+        res = curl_easy_perform(curl);
+        mem_phase(MEM_OTHER);
+        double delay = retry ? retry_plan(retry, curl, res, attempt) : -1.0;
+        if (delay < 0.0) break;
+        char why[CURL_ERROR_SIZE];
+        retry_reason(curl, res, errbuf, why, sizeof(why));
+        fprintf(stderr, "[!] %s: %s; retry %d of %ld in %.1f s\n", url, why, attempt, retry->max_retries,
+                delay / 1000.0);
+        kno_free(chunk.data);
+        chunk.data = NULL;
+        chunk.size = 0;
+        if (hdr) header_urls_reset(hdr);
+        retry_sleep_ms(delay);
+    }
+    if (res != CURLE_OK) {
+        fprintf(stderr, "[-] CURL error fetching %s: %s\n", url, errbuf[0] ? errbuf : curl_easy_strerror(res));
+        curl_easy_cleanup(curl);
+        kno_free(chunk.data);
+        return NULL;
+    }
+
+    if (fs) fetch_collect_stats(curl, fs);
+    curl_easy_cleanup(curl);
+    /* An empty body (a 301 that is not followed, a 204) is still a page. */
+    if (!chunk.data) chunk.data = (char *)kno_calloc(1, 1);
+    return chunk.data;  /* caller frees */
+}
+
+/* ---------- URL normalization & token parsing ---------- */
+static char *normalize_url(const char *u) {
+    if (!u || !*u) return NULL;
+    if (!strncmp(u, "http://", 7) || !strncmp(u, "https://", 8)) {
+        return kno_strdup(u);
+    }
+    if (!strncmp(u, "www.", 4)) {
+        size_t len = strlen(u) + 9;
+        char *res = (char *)kno_malloc(len);
+        if (!res) return NULL;
+        snprintf(res, len, "https://%s", u);
+        return res;
+    }
+    if (strchr(u, '.') || strchr(u, ':')) {
+        size_t len = strlen(u) + 9;
+        char *res = (char *)kno_malloc(len);
+        if (!res) return NULL;
+        snprintf(res, len, "https://%s", u);
+        return res;
+    }
+    return kno_strdup(u);
+}
+
+/* Split line into tokens (in-place, modifies buffer). Returns count.
+ * A token starting with ' or " runs to the matching quote, which is dropped. */
+static int split_tokens(char *line, char **tokens, int max_tokens) {
+    int count = 0;
+    char *p = line;
+    while (*p && count < max_tokens) {
+        while (isspace((unsigned char)*p)) p++;
+        if (!*p) break;
+        if (*p == '\'' || *p == '"') {
+            char quote = *p++;
+            tokens[count++] = p;
+            while (*p && *p != quote) p++;
+        } else {
+            tokens[count++] = p;
+            while (*p && !isspace((unsigned char)*p)) p++;
+        }
+        if (*p) {
+            *p = '\0';
+            p++;
+        }
+    }
+    return count;
+}
+
+/*
+ * The target of a command line: "-u <url>", a leading non-flag token, or the
+ * first http(s)/www token. *arg_start is set to the index of the first flag.
+ * Returns a normalized copy (caller frees) or NULL.
+ */
+static char *command_url(char **tokens, int ntok, int *arg_start) {
+    *arg_start = 0;
+    if (ntok == 0) return NULL;
+    if (strcmp(tokens[0], "-u") == 0 && ntok >= 2) {
+        *arg_start = 2;
+        return normalize_url(tokens[1]);
+    }
+    if (tokens[0][0] != '-') {
+        *arg_start = 1;
+        return normalize_url(tokens[0]);
+    }
+    for (int i = 0; i < ntok; i++) {
+        if (!strncmp(tokens[i], "http://", 7) ||
+            !strncmp(tokens[i], "https://", 8) ||
+            !strncmp(tokens[i], "www.", 4)) {
+            *arg_start = i + 1;
+            return normalize_url(tokens[i]);
+        }
+    }
+    return NULL;
+}
+
+/* ---------- URL extraction (simplified) ---------- */
+/*
+ * Called once per URL found, in page order per scheme (all http://, then
+ * https://, then blob:). u points into the page and is not NUL-terminated.
+ * Return nonzero to stop the scan.
+ */
+typedef int (*UrlSink)(const char *u, size_t len, void *ud);
+
+/*
+ * Next occurrence of pat in [p, end), or NULL. Candidates are found with
+ * memchr on the ':' of the scheme, which is far rarer in markup than 'h'.
+ */
+static const char *span_find(const char *p, const char *end, const char *pat, size_t plen) {
+    size_t at = (size_t)((const char *)memchr(pat, ':', plen) - pat);
+    const char *c = p + at;
+    while (c < end && (size_t)(end - c) >= plen - at) {
+        c = (const char *)memchr(c, ':', (size_t)(end - c) - (plen - at) + 1);
+        if (!c) return NULL;
+        if (memcmp(c - at, pat, plen) == 0) return c - at;
+        c++;
+    }
+    return NULL;
+}
+
+/* Bytes that end a URL: NUL, whitespace (as isspace() in the C locale), quotes, < and >. */
+static const unsigned char k_url_stop[256] = {
+    [0] = 1, [' '] = 1, ['\t'] = 1, ['\n'] = 1, ['\v'] = 1, ['\f'] = 1, ['\r'] = 1,
+    ['"'] = 1, ['\''] = 1, ['<'] = 1, ['>'] = 1,
+};
+
+/* Scan len bytes of html without copying. Returns the number of URLs passed to sink. */
+static size_t extract_urls_scan(const char *html, size_t len, UrlSink sink, void *ud) {
+    static const struct { const char *s; size_t n; } schemes[] = {
+        { "http://", 7 }, { "https://", 8 }, { "blob:", 5 },
+    };
+    const char *end = html + len;
+    size_t found = 0;
+
+    for (size_t k = 0; k < sizeof(schemes) / sizeof(schemes[0]); k++) {
+        const char *p = html;
+        while ((p = span_find(p, end, schemes[k].s, schemes[k].n)) != NULL) {
+            const char *q = p;
+            while (q < end && !k_url_stop[(unsigned char)*q]) q++;
+            found++;
+            if (sink(p, (size_t)(q - p), ud)) return found;
+            p = q;
+        }
+    }
+    return found;
+}
+
+static int sink_strlist(const char *u, size_t len, void *ud) {
+    sl_add_n((StrList *)ud, u, len);
+    return 0;
+}
+
+static void extract_urls_from_html(const char *html, size_t len, StrList *urls) {
+    extract_urls_scan(html, len, sink_strlist, urls);
+}
+
+/* ---------- Categorization helpers ---------- */
+static const char *get_ext(const char *url) {
+    const char *p = strrchr(url, '.');
+    if (!p) return "";
+    const char *slash = strchr(p, '/');
+    if (slash) return "";
+    return p;
+}
+
+/* Host part of an absolute URL (blob: prefix skipped); *len is 0 if none. */
+static const char *url_host(const char *u, size_t *len) {
+    if (!strncmp(u, "blob:", 5)) u += 5;
+    const char *p = u;
+    *len = 0;
+    while (*p && *p != ':' && *p != '/') p++;   /* scheme */
+    if (p[0] != ':' || p[1] != '/' || p[2] != '/') return u;
+    p += 3;
+    const char *h = p;
+    const char *at = NULL;
+    while (*p && *p != '/' && *p != '?' && *p != '#') {
+        if (*p == '@') at = p;
+        p++;
+    }
+    if (at) h = at + 1;
+    const char *e = h;
+    while (e < p && *e != ':') e++;
+    *len = (size_t)(e - h);
+    return h;
+}
+
+/* Path (and anything after it) given the host found by url_host, or "" if there is none. */
+static const char *url_path_after_host(const char *host, size_t host_len) {
+    if (!host_len) return "";
+    const char *p = host + host_len;
+    while (*p && *p != '/' && *p != '?' && *p != '#') p++;
+    return p;
+}
+
+/* ---------- Category rules ---------- */
+/*
+ * Built-in categories come first; a rules file (--rules at startup) may add
+ * more. Extensions from both sources live in one perfect hash, path prefixes
+ * in a trie and host patterns in a trie over the reversed host, all built
+ * once before the first command and read-only afterwards.
+ *
+ * Rules file, one rule per line ('#' starts a comment):
+ *
+ *   ext  .foo .bar            => CLIENT ASSETS
+ *   path /static/ /cdn-cgi/   => STATIC
+ *   host *.cdn.example.com    => CDN
+ *
+ * Host and path rules win over the built-in rules; extension rules replace a
+ * built-in extension of the same name.
+ */
+enum { CAT_SCRIPTS, CAT_MEDIA, CAT_API, CAT_DOCS, CAT_HTML, CAT_OTHER, CAT_BUILTIN_COUNT };
+
+#define MAX_CATEGORIES 64
+#define EXT_KEY_MAX 16
+
+static const char *g_cat_names[MAX_CATEGORIES] = {
+    "SCRIPTS", "MEDIA", "API / ENDPOINTS", "DOCUMENTS / CONFIG", "HTML / FRAMEWORK", "OTHER"
+};
+static int g_cat_count = CAT_BUILTIN_COUNT;
+
+static const struct {
+    const char *ext;
+    int cat;
+} k_builtin_exts[] = {
+    {".js", CAT_SCRIPTS}, {".mjs", CAT_SCRIPTS},
+    {".png", CAT_MEDIA}, {".jpg", CAT_MEDIA}, {".jpeg", CAT_MEDIA}, {".gif", CAT_MEDIA},
+    {".svg", CAT_MEDIA}, {".webp", CAT_MEDIA}, {".ico", CAT_MEDIA}, {".mp4", CAT_MEDIA},
+    {".mov", CAT_MEDIA}, {".wav", CAT_MEDIA},
+    {".json", CAT_DOCS}, {".xml", CAT_DOCS}, {".yml", CAT_DOCS}, {".yaml", CAT_DOCS},
+    {".pdf", CAT_DOCS}, {".txt", CAT_DOCS}, {".doc", CAT_DOCS}, {".docx", CAT_DOCS},
+    {".csv", CAT_DOCS},
+    {".html", CAT_HTML}, {".htm", CAT_HTML},
+};
+
+/* Extension perfect hash: bucket = top bits of the key hash, slot = mix(hash ^ disp[bucket]). */
+typedef struct {
+    char key[EXT_KEY_MAX];
+    unsigned char len;
+    signed char cat;        /* -1 = empty slot */
+} ExtSlot;
+
+typedef struct {
+    ExtSlot *slots;
+    uint32_t *disp;
+    uint32_t slot_mask;
+    uint32_t bucket_mask;
+} ExtTable;
+
+typedef struct {
+    char key[EXT_KEY_MAX];
+    unsigned char len;
+    signed char cat;
+    uint64_t hash;
+} ExtEntry;
+
+static uint64_t ext_hash(const char *s, size_t n) {
+    uint64_t h = 1469598103934665603ULL;
+    for (size_t i = 0; i < n; i++) {
+        h ^= fold_ascii((unsigned char)s[i]);
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static uint64_t ext_mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static size_t pow2_at_least(size_t n) {
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+typedef struct {
+    uint32_t bucket;
+    uint32_t count;
+    uint32_t first;         /* index into the bucket-sorted entry order */
+} ExtBucket;
+
+static const ExtEntry *g_sort_entries;
+static uint32_t g_sort_bucket_mask;
+
+static int cmp_entry_bucket(const void *a, const void *b) {
+    uint32_t ba = (uint32_t)(g_sort_entries[*(const uint32_t *)a].hash >> 32) & g_sort_bucket_mask;
+    uint32_t bb = (uint32_t)(g_sort_entries[*(const uint32_t *)b].hash >> 32) & g_sort_bucket_mask;
+    return (ba > bb) - (ba < bb);
+}
+
+static int cmp_bucket_size(const void *a, const void *b) {
+    const ExtBucket *x = (const ExtBucket *)a;
+    const ExtBucket *y = (const ExtBucket *)b;
+    return (y->count > x->count) - (y->count < x->count);
+}
+
+/* Hash-and-displace construction; retries with a larger table if a bucket cannot be placed. */
+static int ext_table_build(ExtTable *t, const ExtEntry *e, size_t n) {
+    size_t nslots = pow2_at_least(n * 2 < 16 ? 16 : n * 2);
+    size_t nbuckets = pow2_at_least(n / 2 < 4 ? 4 : n / 2);
+
+    for (int attempt = 0; attempt < 8; attempt++, nslots <<= 1) {
+        ExtSlot *slots = (ExtSlot *)kno_malloc(nslots * sizeof(ExtSlot));
+        uint32_t *disp = (uint32_t *)kno_calloc(nbuckets, sizeof(uint32_t));
+        uint32_t *order = (uint32_t *)kno_malloc((n ? n : 1) * sizeof(uint32_t));
+        ExtBucket *buckets = (ExtBucket *)kno_calloc(nbuckets, sizeof(ExtBucket));
+        int allocated = slots && disp && order && buckets;
+        int ok = allocated;
+
+        if (ok) {
+            for (size_t i = 0; i < nslots; i++) slots[i].cat = -1;
+            for (size_t i = 0; i < n; i++) order[i] = (uint32_t)i;
+            g_sort_entries = e;
+            g_sort_bucket_mask = (uint32_t)(nbuckets - 1);
+            qsort(order, n, sizeof(uint32_t), cmp_entry_bucket);
+            for (size_t i = 0; i < nbuckets; i++) buckets[i].bucket = (uint32_t)i;
+            for (size_t i = 0; i < n; i++) {
+                uint32_t bk = (uint32_t)(e[order[i]].hash >> 32) & (uint32_t)(nbuckets - 1);
+                if (buckets[bk].count == 0) buckets[bk].first = (uint32_t)i;
+                buckets[bk].count++;
+            }
+            qsort(buckets, nbuckets, sizeof(ExtBucket), cmp_bucket_size);
+
+            for (size_t bi = 0; ok && bi < nbuckets && buckets[bi].count > 0; bi++) {
+                const ExtBucket *bk = &buckets[bi];
+                uint32_t d;
+                for (d = 0; d < (1u << 16); d++) {
+                    uint32_t placed = 0;
+                    for (; placed < bk->count; placed++) {
+                        const ExtEntry *en = &e[order[bk->first + placed]];
+                        size_t sl = (size_t)ext_mix(en->hash ^ d) & (nslots - 1);
+                        if (slots[sl].cat >= 0) break;
+                        memcpy(slots[sl].key, en->key, EXT_KEY_MAX);
+                        slots[sl].len = en->len;
+                        slots[sl].cat = en->cat;
+                    }
+                    if (placed == bk->count) break;
+                    /* Undo the partial placement and try the next displacement. */
+                    for (uint32_t k = 0; k < placed; k++) {
+                        const ExtEntry *en = &e[order[bk->first + k]];
+                        slots[(size_t)ext_mix(en->hash ^ d) & (nslots - 1)].cat = -1;
+                    }
+                }
+                if (d == (1u << 16)) ok = 0;
+                else disp[bk->bucket] = d;
+            }
+        }
+
+        kno_free(order);
+        kno_free(buckets);
+        if (ok) {
+            t->slots = slots;
+            t->disp = disp;
+            t->slot_mask = (uint32_t)(nslots - 1);
+            t->bucket_mask = (uint32_t)(nbuckets - 1);
+            return 1;
+        }
+        kno_free(slots);
+        kno_free(disp);
+        if (!allocated) return 0;
+    }
+    return 0;
+}
+
+static int ext_table_lookup(const ExtTable *t, const char *ext, size_t n) {
+    if (!t->slots || n == 0 || n >= EXT_KEY_MAX) return -1;
+    uint64_t h = ext_hash(ext, n);
+    uint32_t d = t->disp[(uint32_t)(h >> 32) & t->bucket_mask];
+    const ExtSlot *sl = &t->slots[(size_t)ext_mix(h ^ d) & t->slot_mask];
+    if (sl->cat < 0 || sl->len != n) return -1;
+    for (size_t i = 0; i < n; i++) {
+        if (fold_ascii((unsigned char)ext[i]) != (unsigned char)sl->key[i]) return -1;
+    }
+    return sl->cat;
+}
+
+/*
+ * Byte trie: path prefixes as-is, host patterns reversed and folded. Built as
+ * a linked trie, then frozen into a DFA over byte classes so a lookup costs
+ * one table load per input byte.
+ */
+typedef struct {
+    int child;              /* first child, -1 if none */
+    int sibling;            /* next sibling, -1 if none */
+    unsigned char ch;
+    signed char cat_end;    /* category if the key ends exactly here */
+    signed char cat_more;   /* category if the key continues past here */
+} TrieNode;
+
+typedef struct {
+    TrieNode *nodes;
+    size_t count;
+    size_t capacity;
+    int fold;               /* case-insensitive (host trie) */
+    /* Frozen form: next[state * nclasses + cls[byte]], state 0 = no match. */
+    uint32_t *next;
+    unsigned char cls[256];
+    int nclasses;
+} Trie;
+
+static int trie_new_node(Trie *t, unsigned char ch) {
+    if (t->count + 1 > t->capacity) {
+        size_t newcap = (t->capacity == 0) ? 64 : t->capacity * 2;
+        TrieNode *nn = (TrieNode *)kno_realloc(t->nodes, newcap * sizeof(TrieNode));
+        if (!nn) return -1;
+        t->nodes = nn;
+        t->capacity = newcap;
+    }
+    TrieNode *n = &t->nodes[t->count];
+    n->child = -1;
+    n->sibling = -1;
+    n->ch = ch;
+    n->cat_end = -1;
+    n->cat_more = -1;
+    return (int)t->count++;
+}
+
+/* Insert key; returns the final node or -1. */
+static int trie_insert(Trie *t, const char *key, size_t n) {
+    if (t->count == 0 && trie_new_node(t, 0) < 0) return -1;
+    int cur = 0;
+    for (size_t i = 0; i < n; i++) {
+        unsigned char c = (unsigned char)(t->fold ? fold_ascii((unsigned char)key[n - 1 - i]) : key[i]);
+        int ch = t->nodes[cur].child;
+        while (ch >= 0 && t->nodes[ch].ch != c) ch = t->nodes[ch].sibling;
+        if (ch < 0) {
+            ch = trie_new_node(t, c);
+            if (ch < 0) return -1;
+            t->nodes[ch].sibling = t->nodes[cur].child;
+            t->nodes[cur].child = ch;
+        }
+        cur = ch;
+    }
+    return cur;
+}
+
+/* Build the DFA. Trie node i becomes state i; the root is only a start state. */
+static int trie_freeze(Trie *t) {
+    if (t->count == 0) return 1;
+    memset(t->cls, 0, sizeof(t->cls));
+    t->nclasses = 1;        /* class 0: bytes that appear in no key */
+    for (size_t i = 1; i < t->count; i++) {
+        unsigned char c = t->nodes[i].ch;
+        if (!t->cls[c]) t->cls[c] = (unsigned char)t->nclasses++;
+    }
+    if (t->fold) {
+        for (int c = 'A'; c <= 'Z'; c++) t->cls[c] = t->cls[c | 0x20];
+    }
+    t->next = (uint32_t *)kno_calloc(t->count * (size_t)t->nclasses, sizeof(uint32_t));
+    if (!t->next) return 0;
+    for (size_t i = 0; i < t->count; i++) {
+        for (int ch = t->nodes[i].child; ch >= 0; ch = t->nodes[ch].sibling) {
+            t->next[i * (size_t)t->nclasses + t->cls[t->nodes[ch].ch]] = (uint32_t)ch;
+        }
+    }
+    return 1;
+}
+
+/* Longest match: a node's cat_more applies while input remains, cat_end once it is used up. */
+static int trie_lookup(const Trie *t, const char *s, size_t n) {
+    if (!t->next) return -1;
+    uint32_t cur = 0;
+    int best = -1;
+    for (size_t i = 0; i < n; i++) {
+        unsigned char c = (unsigned char)(t->fold ? s[n - 1 - i] : s[i]);
+        cur = t->next[cur * (size_t)t->nclasses + t->cls[c]];
+        if (!cur) return best;
+        if (i + 1 < n && t->nodes[cur].cat_more >= 0) best = t->nodes[cur].cat_more;
+    }
+    if (t->nodes[cur].cat_end >= 0) return t->nodes[cur].cat_end;
+    return best;
+}
+
+static ExtTable g_ext_table;
+static Trie g_path_trie;
+static Trie g_host_trie = { NULL, 0, 0, 1, NULL, {0}, 0 };
+
+static int category_add(const char *name) {
+    for (int i = 0; i < g_cat_count; i++) {
+        if (!strcmp(g_cat_names[i], name)) return i;
+    }
+    if (g_cat_count >= MAX_CATEGORIES) return -1;
+    char *copy = kno_strdup(name);
+    if (!copy) return -1;
+    g_cat_names[g_cat_count] = copy;
+    return g_cat_count++;
+}
+
+static void ext_entry_add(ExtEntry **entries, size_t *n, size_t *cap, const char *ext, size_t len, int cat) {
+    for (size_t i = 0; i < *n; i++) {
+        ExtEntry *e = &(*entries)[i];
+        size_t k = 0;
+        if (e->len != len) continue;
+        while (k < len && fold_ascii((unsigned char)ext[k]) == (unsigned char)e->key[k]) k++;
+        if (k == len) {
+            e->cat = (signed char)cat;
+            return;
+        }
+    }
+    if (*n + 1 > *cap) {
+        size_t newcap = (*cap == 0) ? 64 : *cap * 2;
+        ExtEntry *ne = (ExtEntry *)kno_realloc(*entries, newcap * sizeof(ExtEntry));
+        if (!ne) return;
+        *entries = ne;
+        *cap = newcap;
+    }
+    ExtEntry *e = &(*entries)[(*n)++];
+    memset(e->key, 0, sizeof(e->key));
+    for (size_t i = 0; i < len; i++) e->key[i] = (char)fold_ascii((unsigned char)ext[i]);
+    e->len = (unsigned char)len;
+    e->cat = (signed char)cat;
+    e->hash = ext_hash(ext, len);
+}
+
+/* Load the rules file (if any) and build the lookup structures. Returns 0 on error. */
+static int category_rules_init(const char *rules_path) {
+    ExtEntry *entries = NULL;
+    size_t nent = 0, capent = 0;
+    int ok = 1;
+
+    for (size_t i = 0; i < sizeof(k_builtin_exts) / sizeof(k_builtin_exts[0]); i++) {
+        ext_entry_add(&entries, &nent, &capent, k_builtin_exts[i].ext,
+                      strlen(k_builtin_exts[i].ext), k_builtin_exts[i].cat);
+    }
+
+    if (rules_path) {
+        FILE *f = fopen(rules_path, "r");
+        char line[MAX_LINE];
+        int lineno = 0;
+        size_t nrules = 0;
+
+        if (!f) {
+            fprintf(stderr, "[-] Could not open rules file %s\n", rules_path);
+            kno_free(entries);
+            return 0;
+        }
+        while (ok && fgets(line, sizeof(line), f)) {
+            lineno++;
+            char *hash = strchr(line, '#');
+            if (hash) *hash = '\0';
+            char *arrow = strstr(line, "=>");
+            char *tokens[64];
+            int ntok;
+
+            if (!arrow) {
+                if (split_tokens(line, tokens, 64) == 0) continue;
+                fprintf(stderr, "[-] %s:%d: expected '<ext|path|host> patterns... => CATEGORY'\n", rules_path, lineno);
+                ok = 0;
+                break;
+            }
+            *arrow = '\0';
+            char *name = arrow + 2;
+            while (isspace((unsigned char)*name)) name++;
+            size_t nl = strlen(name);
+            while (nl > 0 && isspace((unsigned char)name[nl - 1])) name[--nl] = '\0';
+
+            ntok = split_tokens(line, tokens, 64);
+            if (ntok < 2 || !*name) {
+                fprintf(stderr, "[-] %s:%d: rule needs a kind, at least one pattern and a category name\n", rules_path, lineno);
+                ok = 0;
+                break;
+            }
+            int cat = category_add(name);
+            if (cat < 0) {
+                fprintf(stderr, "[-] %s:%d: too many categories (max %d)\n", rules_path, lineno, MAX_CATEGORIES);
+                ok = 0;
+                break;
+            }
+
+            for (int i = 1; ok && i < ntok; i++) {
+                const char *pat = tokens[i];
+                size_t pl = strlen(pat);
+                if (!strcmp(tokens[0], "ext")) {
+                    if (pat[0] != '.' || pl < 2 || pl >= EXT_KEY_MAX) {
+                        fprintf(stderr, "[-] %s:%d: bad extension '%s' (expected .ext)\n", rules_path, lineno, pat);
+                        ok = 0;
+                    } else {
+                        ext_entry_add(&entries, &nent, &capent, pat, pl, cat);
+                    }
+                } else if (!strcmp(tokens[0], "path")) {
+                    int node = (pat[0] == '/') ? trie_insert(&g_path_trie, pat, pl) : -1;
+                    if (node < 0) {
+                        fprintf(stderr, "[-] %s:%d: bad path prefix '%s' (must start with /)\n", rules_path, lineno, pat);
+                        ok = 0;
+                    } else {
+                        g_path_trie.nodes[node].cat_end = (signed char)cat;
+                        g_path_trie.nodes[node].cat_more = (signed char)cat;
+                    }
+                } else if (!strcmp(tokens[0], "host")) {
+                    int wildcard = !strncmp(pat, "*.", 2);
+                    const char *key = wildcard ? pat + 1 : pat;
+                    int node = (strchr(key, '*') || !*key) ? -1 : trie_insert(&g_host_trie, key, strlen(key));
+                    if (node < 0) {
+                        fprintf(stderr, "[-] %s:%d: bad host pattern '%s' (use host or *.domain)\n", rules_path, lineno, pat);
+                        ok = 0;
+                    } else if (wildcard) {
+                        g_host_trie.nodes[node].cat_more = (signed char)cat;
+                    } else {
+                        g_host_trie.nodes[node].cat_end = (signed char)cat;
+                    }
+                } else {
+                    fprintf(stderr, "[-] %s:%d: unknown rule kind '%s' (use ext, path or host)\n", rules_path, lineno, tokens[0]);
+                    ok = 0;
+                }
+            }
+            nrules++;
+        }
+        fclose(f);
+        if (ok) {
+            printf("[*] Loaded %zu category rules from %s (%d categories)\n",
+                   nrules, rules_path, g_cat_count);
+        }
+    }
+
+    if (ok && (!ext_table_build(&g_ext_table, entries, nent) ||
+               !trie_freeze(&g_path_trie) || !trie_freeze(&g_host_trie))) {
+        fprintf(stderr, "[-] Failed to build category lookup tables\n");
+        ok = 0;
+    }
+    kno_free(entries);
+    return ok;
+}
+
+static const Needle k_graphql = { "graphql", 7, 'g', 'G', 'l', 'L' };
+
+static int categorize_url(const char *url) {
+    int cat;
+
+    if (g_host_trie.next || g_path_trie.next) {
+        size_t hl;
+        const char *h = url_host(url, &hl);
+        if ((cat = trie_lookup(&g_host_trie, h, hl)) >= 0) return cat;
+        const char *path = url_path_after_host(h, hl);
+        if ((cat = trie_lookup(&g_path_trie, path, strlen(path))) >= 0) return cat;
+    }
+
+    if (strstr(url, "/api/") || needle_match(&k_graphql, url, strlen(url))) {
+        return CAT_API;
+    }
+
+    const char *ext = get_ext(url);
+    if ((cat = ext_table_lookup(&g_ext_table, ext, strlen(ext))) >= 0) {
+        return cat;
+    }
+    if (strstr(url, ".bundle.js") || strstr(url, ".chunk.js")) {
+        return CAT_HTML;
+    }
+
+    return CAT_OTHER;
+}
+
+/* ---------- Latency histograms (batch runs) ---------- */
+/*
+ * Log-linear buckets in microseconds: values below 2^HIST_SUB_BITS get one
+ * bucket each, and every power of two above that is split into 2^HIST_SUB_BITS
+ * linear sub-buckets (about 3% relative error). Each thread records into its
+ * own LatRecorder without locks; recorders are pushed onto a lock-free list
+ * once and merged only when a report is printed.
+ */
+#define HIST_SUB_BITS 5
+#define HIST_SUB (1 << HIST_SUB_BITS)
+#define HIST_MAX_BITS 40                    /* values clamp below 2^40 us (~12 days) */
+#define HIST_BUCKETS ((HIST_MAX_BITS - HIST_SUB_BITS + 1) * HIST_SUB)
+
+enum { LAT_TTFB, LAT_TOTAL, LAT_PARSE, LAT_COUNT };
+static const char *k_lat_names[LAT_COUNT] = {"ttfb", "total", "parse"};
+
+typedef struct {
+    uint32_t counts[HIST_BUCKETS];
+    uint64_t n;
+    uint64_t max;
+} Histogram;
+
+typedef struct {
+    char *host;
+    Histogram h[LAT_COUNT];
+} HostHist;
+
+typedef struct LatRecorder {
+    HostHist *hosts;
+    size_t count;
+    size_t capacity;
+    struct LatRecorder *next;
+} LatRecorder;
+
+static LatRecorder *_Atomic g_lat_recorders = NULL;
+static _Thread_local LatRecorder *t_lat = NULL;
+
+static int msb64(uint64_t v) {
+#if defined(__GNUC__)
+    return 63 - __builtin_clzll(v);
+#else
+    int r = 0;
+    while (v >>= 1) r++;
+    return r;
+#endif
+}
+
+static int hist_bucket(uint64_t v) {
+    if (v < HIST_SUB) return (int)v;
+    if (v >= ((uint64_t)1 << HIST_MAX_BITS)) v = ((uint64_t)1 << HIST_MAX_BITS) - 1;
+    int shift = msb64(v) - HIST_SUB_BITS;
+    return (shift + 1) * HIST_SUB + (int)((v >> shift) - HIST_SUB);
+}
+
+/* Highest value that lands in bucket b. */
+static uint64_t hist_bucket_high(int b) {
+    if (b < HIST_SUB) return (uint64_t)b;
+    int shift = b / HIST_SUB - 1;
+    uint64_t sub = (uint64_t)(b % HIST_SUB + HIST_SUB);
+    return ((sub + 1) << shift) - 1;
+}
+
+static void hist_record(Histogram *h, uint64_t v) {
+    h->counts[hist_bucket(v)]++;
+    h->n++;
+    if (v > h->max) h->max = v;
+}
+
+static void hist_merge(Histogram *dst, const Histogram *src) {
+    for (int b = 0; b < HIST_BUCKETS; b++) dst->counts[b] += src->counts[b];
+    dst->n += src->n;
+    if (src->max > dst->max) dst->max = src->max;
+}
+
+static uint64_t hist_percentile(const Histogram *h, double p) {
+    if (h->n == 0) return 0;
+    uint64_t want = (uint64_t)(p * (double)h->n + 0.999999);
+    uint64_t seen = 0;
+    if (want < 1) want = 1;
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        seen += h->counts[b];
+        if (seen >= want) {
+            uint64_t hi = hist_bucket_high(b);
+            return hi < h->max ? hi : h->max;
+        }
+    }
+    return h->max;
+}
+
+static HostHist *lat_host(LatRecorder *r, const char *host, size_t hl) {
+    for (size_t i = 0; i < r->count; i++) {
+        if (strlen(r->hosts[i].host) == hl && !memcmp(r->hosts[i].host, host, hl)) return &r->hosts[i];
+    }
+    if (r->count + 1 > r->capacity) {
+        size_t newcap = (r->capacity == 0) ? 8 : r->capacity * 2;
+        HostHist *nh = (HostHist *)kno_realloc(r->hosts, newcap * sizeof(HostHist));
+        if (!nh) return NULL;
+        r->hosts = nh;
+        r->capacity = newcap;
+    }
+    HostHist *hh = &r->hosts[r->count];
+    memset(hh, 0, sizeof(*hh));
+    hh->host = (char *)kno_malloc(hl + 1);
+    if (!hh->host) return NULL;
+    memcpy(hh->host, host, hl);
+    hh->host[hl] = '\0';
+    r->count++;
+    return hh;
+}
+
+/* Record one sample for the calling thread; "" groups samples without a host. */
+static void lat_record(const char *url, int metric, double ms) {
+    if (!t_lat) {
+        t_lat = (LatRecorder *)kno_calloc(1, sizeof(LatRecorder));
+        if (!t_lat) return;
+        LatRecorder *head = atomic_load_explicit(&g_lat_recorders, memory_order_relaxed);
+        do {
+            t_lat->next = head;
+        } while (!atomic_compare_exchange_weak_explicit(&g_lat_recorders, &head, t_lat,
+                                                        memory_order_release, memory_order_relaxed));
+    }
+    size_t hl = 0;
+    const char *host = url ? url_host(url, &hl) : "";
+    HostHist *hh = lat_host(t_lat, host, hl);
+    if (hh) hist_record(&hh->h[metric], ms > 0.0 ? (uint64_t)(ms * 1000.0) : 0);
+}
+
+/* Clear every recorder; only call while no other thread is recording. */
+static void lat_reset(void) {
+    for (LatRecorder *r = atomic_load(&g_lat_recorders); r; r = r->next) {
+        for (size_t i = 0; i < r->count; i++) kno_free(r->hosts[i].host);
+        r->count = 0;
+    }
+}
+
+static void lat_print_line(const char *label, const Histogram *h) {
+    printf("[*]   %-6s n=%-7llu p50 %9.2f  p90 %9.2f  p99 %9.2f  p999 %9.2f  max %9.2f ms\n",
+           label, (unsigned long long)h->n,
+           (double)hist_percentile(h, 0.50) / 1000.0, (double)hist_percentile(h, 0.90) / 1000.0,
+           (double)hist_percentile(h, 0.99) / 1000.0, (double)hist_percentile(h, 0.999) / 1000.0,
+           (double)h->max / 1000.0);
+}
+
+/* Merge all recorders and print global (and optionally per-host) percentiles. */
+static void lat_report(int per_host) {
+    LatRecorder merged;
+    Histogram *global = (Histogram *)kno_calloc(LAT_COUNT, sizeof(Histogram));
+    memset(&merged, 0, sizeof(merged));
+    if (!global) return;
+
+    for (LatRecorder *r = atomic_load(&g_lat_recorders); r; r = r->next) {
+        for (size_t i = 0; i < r->count; i++) {
+            HostHist *dst = lat_host(&merged, r->hosts[i].host, strlen(r->hosts[i].host));
+            for (int m = 0; m < LAT_COUNT; m++) {
+                if (dst) hist_merge(&dst->h[m], &r->hosts[i].h[m]);
+                hist_merge(&global[m], &r->hosts[i].h[m]);
+            }
+        }
+    }
+
+    printf("[*] latency percentiles (all hosts)\n");
+    for (int m = 0; m < LAT_COUNT; m++) {
+        lat_print_line(k_lat_names[m], &global[m]);
+    }
+    if (per_host) {
+        for (size_t i = 0; i < merged.count; i++) {
+            printf("[*] latency percentiles: %s\n", merged.hosts[i].host[0] ? merged.hosts[i].host : "(no host)");
+            for (int m = 0; m < LAT_COUNT; m++) {
+                lat_print_line(k_lat_names[m], &merged.hosts[i].h[m]);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < merged.count; i++) kno_free(merged.hosts[i].host);
+    kno_free(merged.hosts);
+    kno_free(global);
+}
+
+/* ---------- Live metrics endpoint (--metrics) ---------- */
+/*
+ * Batch counters are plain relaxed atomics bumped from the fetch loop; a
+ * side thread serves them in Prometheus text format over a Unix socket
+ * (any address containing '/') or plain HTTP on 127.0.0.1:<port>.
+ */
+enum { ERR_DNS, ERR_CONNECT, ERR_TIMEOUT, ERR_TLS, ERR_HTTP, ERR_OTHER, ERR_COUNT };
+static const char *k_err_names[ERR_COUNT] = {"dns", "connect", "timeout", "tls", "http", "other"};
+
+typedef struct {
+    atomic_uint_fast64_t in_flight;
+    atomic_uint_fast64_t pending;       /* targets not started yet */
+    atomic_uint_fast64_t completed;     /* transfers finished, retries excluded */
+    atomic_uint_fast64_t pages;
+    atomic_uint_fast64_t bytes;
+    atomic_uint_fast64_t urls;
+    atomic_uint_fast64_t errors[ERR_COUNT];
+    atomic_uint_fast64_t retries;
+    atomic_uint_fast64_t retrying;      /* transfers waiting for a retry */
+} Metrics;
+
+static Metrics g_metrics;
+
+#define METRIC_ADD(field, n) atomic_fetch_add_explicit(&g_metrics.field, (uint_fast64_t)(n), memory_order_relaxed)
+#define METRIC_SET(field, v) atomic_store_explicit(&g_metrics.field, (uint_fast64_t)(v), memory_order_relaxed)
+#define METRIC_GET(field) ((unsigned long long)atomic_load_explicit(&g_metrics.field, memory_order_relaxed))
+
+static void metrics_reset(void) {
+    METRIC_SET(in_flight, 0);
+    METRIC_SET(pending, 0);
+    METRIC_SET(completed, 0);
+    METRIC_SET(pages, 0);
+    METRIC_SET(bytes, 0);
+    METRIC_SET(urls, 0);
+    for (int e = 0; e < ERR_COUNT; e++) METRIC_SET(errors[e], 0);
+    METRIC_SET(retries, 0);
+    METRIC_SET(retrying, 0);
+}
+
+static int metrics_error_type(CURLcode res) {
+    switch (res) {
+    case CURLE_COULDNT_RESOLVE_HOST:
+    case CURLE_COULDNT_RESOLVE_PROXY:
+        return ERR_DNS;
+    case CURLE_COULDNT_CONNECT:
+        return ERR_CONNECT;
+    case CURLE_OPERATION_TIMEDOUT:
+        return ERR_TIMEOUT;
+    case CURLE_SSL_CONNECT_ERROR:
+    case CURLE_PEER_FAILED_VERIFICATION:
+    case CURLE_SSL_CERTPROBLEM:
+    case CURLE_SSL_CIPHER:
+    case CURLE_SSL_CACERT_BADFILE:
+        return ERR_TLS;
+    case CURLE_HTTP_RETURNED_ERROR:
+        return ERR_HTTP;
+    default:
+        return ERR_OTHER;
+    }
+}
+
+#ifndef _WIN32
+typedef struct {
+    int fd;
+    char *unix_path;
+    atomic_int stop;
+    pthread_t thread;
+    double started_ms;
+    double last_ms;
+    unsigned long long last_bytes;
+    unsigned long long last_urls;
+} MetricsServer;
+
+static long metrics_rss_bytes(void) {
+    FILE *f = fopen("/proc/self/statm", "r");
+    long pages_total = 0, pages_rss = 0;
+    if (!f) return -1;
+    if (fscanf(f, "%ld %ld", &pages_total, &pages_rss) != 2) pages_rss = -1;
+    fclose(f);
+    return pages_rss < 0 ? -1 : pages_rss * sysconf(_SC_PAGESIZE);
+}
+
+static void metrics_emit(char *buf, size_t cap, size_t *n, const char *fmt, ...) {
+    va_list ap;
+    if (*n + 1 >= cap) return;
+    va_start(ap, fmt);
+    int w = vsnprintf(buf + *n, cap - *n, fmt, ap);
+    va_end(ap);
+    if (w > 0) *n = (size_t)w < cap - *n ? *n + (size_t)w : cap - 1;
+}
+
+static size_t metrics_render(MetricsServer *ms, char *buf, size_t cap) {
+    double now = mono_ms();
+    double dt = (now - ms->last_ms) / 1000.0;
+    unsigned long long bytes = METRIC_GET(bytes), urls = METRIC_GET(urls);
+    long rss = metrics_rss_bytes();
+    size_t n = 0;
+
+    metrics_emit(buf, cap, &n, "# TYPE kno_url_in_flight gauge\nkno_url_in_flight %llu\n", METRIC_GET(in_flight));
+    metrics_emit(buf, cap, &n, "# TYPE kno_url_queue_depth gauge\n");
+    metrics_emit(buf, cap, &n, "kno_url_queue_depth{queue=\"pending\"} %llu\n", METRIC_GET(pending));
+    metrics_emit(buf, cap, &n, "kno_url_queue_depth{queue=\"retry\"} %llu\n", METRIC_GET(retrying));
+    metrics_emit(buf, cap, &n, "# TYPE kno_url_completed_total counter\nkno_url_completed_total %llu\n",
+                 METRIC_GET(completed));
+    metrics_emit(buf, cap, &n, "# TYPE kno_url_pages_total counter\nkno_url_pages_total %llu\n", METRIC_GET(pages));
+    metrics_emit(buf, cap, &n, "# TYPE kno_url_bytes_total counter\nkno_url_bytes_total %llu\n", bytes);
+    metrics_emit(buf, cap, &n, "# TYPE kno_url_urls_total counter\nkno_url_urls_total %llu\n", urls);
+    /* Rates cover the interval since the previous scrape. */
+    metrics_emit(buf, cap, &n, "# TYPE kno_url_bytes_per_second gauge\nkno_url_bytes_per_second %.1f\n",
+         dt > 0 ? (double)(bytes - ms->last_bytes) / dt : 0.0);
+    metrics_emit(buf, cap, &n, "# TYPE kno_url_urls_per_second gauge\nkno_url_urls_per_second %.1f\n",
+         dt > 0 ? (double)(urls - ms->last_urls) / dt : 0.0);
+    metrics_emit(buf, cap, &n, "# TYPE kno_url_errors_total counter\n");
+    for (int e = 0; e < ERR_COUNT; e++) {
+        metrics_emit(buf, cap, &n, "kno_url_errors_total{type=\"%s\"} %llu\n", k_err_names[e], METRIC_GET(errors[e]));
+    }
+    metrics_emit(buf, cap, &n, "# TYPE kno_url_retries_total counter\nkno_url_retries_total %llu\n", METRIC_GET(retries));
+    if (rss >= 0) metrics_emit(buf, cap, &n, "# TYPE kno_url_resident_memory_bytes gauge\nkno_url_resident_memory_bytes %ld\n", rss);
+    metrics_emit(buf, cap, &n, "# TYPE kno_url_uptime_seconds gauge\nkno_url_uptime_seconds %.3f\n", (now - ms->started_ms) / 1000.0);
+
+    ms->last_ms = now;
+    ms->last_bytes = bytes;
+    ms->last_urls = urls;
+    return n;
+}
+
+static void metrics_serve_one(MetricsServer *ms, int cfd) {
+    char req[1024];
+    char body[4096];
+    char head[160];
+    struct pollfd p = { cfd, POLLIN, 0 };
+
+    /* Drain the request line; any path gets the same page. */
+    if (poll(&p, 1, 1000) > 0) {
+        ssize_t r = recv(cfd, req, sizeof(req), 0);
+        (void)r;
+    }
+    size_t blen = metrics_render(ms, body, sizeof(body));
+    int hlen = snprintf(head, sizeof(head),
+                        "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                        "Content-Length: %zu\r\nConnection: close\r\n\r\n", blen);
+    if (send(cfd, head, (size_t)hlen, MSG_NOSIGNAL) == hlen) {
+        ssize_t w = send(cfd, body, blen, MSG_NOSIGNAL);
+        (void)w;
+    }
+    close(cfd);
+}
+
+static void *metrics_thread(void *arg) {
+    MetricsServer *ms = (MetricsServer *)arg;
+    struct pollfd p = { ms->fd, POLLIN, 0 };
+    while (!atomic_load(&ms->stop)) {
+        if (poll(&p, 1, 200) <= 0) continue;
+        int cfd = accept(ms->fd, NULL, NULL);
+        if (cfd >= 0) metrics_serve_one(ms, cfd);
+    }
+    return NULL;
+}
+
+/* Bind addr ("/path.sock", "127.0.0.1:9464", "localhost:9464" or "9464"). Returns 0 on error. */
+static int metrics_start(MetricsServer *ms, const char *addr) {
+    memset(ms, 0, sizeof(*ms));
+    ms->fd = -1;
+    if (strchr(addr, '/')) {
+        struct sockaddr_un sun;
+        struct stat st;
+        if (strlen(addr) >= sizeof(sun.sun_path)) {
+            printf("Error: --metrics socket path is too long.\n");
+            return 0;
+        }
+        memset(&sun, 0, sizeof(sun));
+        sun.sun_family = AF_UNIX;
+        strcpy(sun.sun_path, addr);
+        /* Replace a stale socket from an earlier run, never a regular file. */
+        if (stat(addr, &st) == 0 && S_ISSOCK(st.st_mode)) unlink(addr);
+        ms->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (ms->fd < 0 || bind(ms->fd, (struct sockaddr *)&sun, sizeof(sun)) != 0) {
+            fprintf(stderr, "[-] Could not bind metrics socket %s\n", addr);
+            if (ms->fd >= 0) close(ms->fd);
+            return 0;
+        }
+        ms->unix_path = kno_strdup(addr);
+    } else {
+        const char *colon = strrchr(addr, ':');
+        const char *port_s = colon ? colon + 1 : addr;
+        size_t hl = colon ? (size_t)(colon - addr) : 0;
+        long port = atol(port_s);
+        struct sockaddr_in sin;
+        int one = 1;
+        if (hl && !(hl == 9 && strncmp(addr, "127.0.0.1", 9) == 0) &&
+            !(hl == 9 && strncmp(addr, "localhost", 9) == 0)) {
+            printf("Error: --metrics only listens on 127.0.0.1 or a Unix socket path.\n");
+            return 0;
+        }
+        if (port < 1 || port > 65535) {
+            printf("Error: invalid --metrics port: %s\n", port_s);
+            return 0;
+        }
+        memset(&sin, 0, sizeof(sin));
+        sin.sin_family = AF_INET;
+        sin.sin_port = htons((unsigned short)port);
+        sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        ms->fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (ms->fd >= 0) setsockopt(ms->fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (ms->fd < 0 || bind(ms->fd, (struct sockaddr *)&sin, sizeof(sin)) != 0) {
+            fprintf(stderr, "[-] Could not bind metrics endpoint 127.0.0.1:%ld\n", port);
+            if (ms->fd >= 0) close(ms->fd);
+            return 0;
+        }
+    }
+    if (listen(ms->fd, 16) != 0) {
+        fprintf(stderr, "[-] Could not listen on metrics endpoint %s\n", addr);
+        close(ms->fd);
+        kno_free(ms->unix_path);
+        return 0;
+    }
+    ms->started_ms = ms->last_ms = mono_ms();
+    atomic_store(&ms->stop, 0);
+    if (pthread_create(&ms->thread, NULL, metrics_thread, ms) != 0) {
+        fprintf(stderr, "[-] Could not start metrics thread\n");
+        close(ms->fd);
+        if (ms->unix_path) unlink(ms->unix_path);
+        kno_free(ms->unix_path);
+        return 0;
+    }
+    if (ms->unix_path) printf("[*] Metrics on unix:%s\n", ms->unix_path);
+    else printf("[*] Metrics on http://127.0.0.1:%s/metrics\n", strrchr(addr, ':') ? strrchr(addr, ':') + 1 : addr);
+    return 1;
+}
+
+static void metrics_stop(MetricsServer *ms) {
+    if (ms->fd < 0) return;
+    atomic_store(&ms->stop, 1);
+    pthread_join(ms->thread, NULL);
+    close(ms->fd);
+    if (ms->unix_path) unlink(ms->unix_path);
+    kno_free(ms->unix_path);
+    ms->fd = -1;
+}
+#else
+typedef struct {
+    int fd;
+} MetricsServer;
+
+static int metrics_start(MetricsServer *ms, const char *addr) {
+    (void)addr;
+    ms->fd = -1;
+    printf("Error: --metrics is not supported on Windows.\n");
+    return 0;
+}
+
+static void metrics_stop(MetricsServer *ms) {
+    (void)ms;
+}
+#endif
+
+/* ---------- Filter expressions (--filter) ---------- */
+/*
+ * --filter 'cdn|static & !thumb & cat:media & host:*.example.com'
+ *
+ *   expr  := or ('&' or)*
+ *   or    := unary ('|' unary)*
+ *   unary := '!' unary | '(' expr ')' | atom
+ *   atom  := term | cat:<category> | host:<glob>
+ *
+ * '|' binds tighter than '&' (like the comma list of --search), so the
+ * example reads as (cdn or static) and not thumb and media and host.
+ * The expression is compiled once per command into postfix code over a small
+ * atom table. Per URL, every distinct atom is tested once into a bitset and
+ * the code then runs over a bit stack, so each URL is evaluated in one pass.
+ */
+#define FILTER_MAX_ATOMS 64
+#define FILTER_MAX_CODE 256
+#define FILTER_MAX_DEPTH 24     /* keeps the postfix stack within 64 bits */
+
+enum { FOP_ATOM, FOP_NOT, FOP_AND, FOP_OR };
+enum { FATOM_TERM, FATOM_CAT, FATOM_HOST };
+
+typedef struct {
+    unsigned char op;
+    unsigned char atom;
+} FilterOp;
+
+typedef struct {
+    int kind;
+    Needle term;            /* FATOM_TERM */
+    int cat;                /* FATOM_CAT */
+    char *host_glob;        /* FATOM_HOST, folded */
+} FilterAtom;
+
+typedef struct {
+    FilterOp code[FILTER_MAX_CODE];
+    size_t ncode;
+    FilterAtom atoms[FILTER_MAX_ATOMS];
+    size_t natoms;
+    int need_host;
+} Filter;
+
+typedef struct {
+    const char *p;
+    Filter *f;
+    const char *err;
+} FilterParser;
+
+static const struct {
+    const char *alias;
+    int cat;
+} k_cat_aliases[] = {
+    {"scripts", CAT_SCRIPTS}, {"s", CAT_SCRIPTS},
+    {"media", CAT_MEDIA}, {"md", CAT_MEDIA},
+    {"api", CAT_API}, {"a", CAT_API},
+    {"docs", CAT_DOCS}, {"d", CAT_DOCS},
+    {"html", CAT_HTML}, {"ht", CAT_HTML},
+    {"other", CAT_OTHER}, {"o", CAT_OTHER},
+};
+
+/* Resolve a folded cat: argument: built-in alias, or a rules-file name with '_' for spaces. */
+static int filter_category(const char *arg) {
+    for (size_t i = 0; i < sizeof(k_cat_aliases) / sizeof(k_cat_aliases[0]); i++) {
+        if (!strcmp(arg, k_cat_aliases[i].alias)) return k_cat_aliases[i].cat;
+    }
+    for (int c = CAT_BUILTIN_COUNT; c < g_cat_count; c++) {
+        const char *n = g_cat_names[c];
+        size_t i = 0;
+        for (; n[i] && arg[i]; i++) {
+            unsigned char a = (unsigned char)arg[i];
+            unsigned char b = fold_ascii((unsigned char)n[i]);
+            if (a != b && !(a == '_' && b == ' ')) break;
+        }
+        if (!n[i] && !arg[i]) return c;
+    }
+    return -1;
+}
+
+static int filter_is_word_char(char c) {
+    return c && !isspace((unsigned char)c) && c != '|' && c != '&' && c != '!' &&
+           c != '(' && c != ')';
+}
+
+static void fp_skip_ws(FilterParser *fp) {
+    while (isspace((unsigned char)*fp->p)) fp->p++;
+}
+
+static void fp_emit(FilterParser *fp, unsigned char op, unsigned char atom) {
+    if (fp->err) return;
+    if (fp->f->ncode >= FILTER_MAX_CODE) {
+        fp->err = "expression too long";
+        return;
+    }
+    fp->f->code[fp->f->ncode].op = op;
+    fp->f->code[fp->f->ncode].atom = atom;
+    fp->f->ncode++;
+}
+
+/* Intern an atom so repeated terms are scanned only once per URL. */
+static void fp_atom(FilterParser *fp, const char *word, size_t len) {
+    Filter *f = fp->f;
+    char buf[256];
+    int kind = FATOM_TERM;
+    int cat = -1;
+
+    if (len >= sizeof(buf)) {
+        fp->err = "term too long";
+        return;
+    }
+    for (size_t i = 0; i < len; i++) buf[i] = (char)fold_ascii((unsigned char)word[i]);
+    buf[len] = '\0';
+
+    const char *arg = buf;
+    if (!strncmp(buf, "cat:", 4)) {
+        kind = FATOM_CAT;
+        arg = buf + 4;
+        cat = filter_category(arg);
+        if (cat < 0) {
+            fp->err = "unknown category (use scripts, media, api, docs, html, other or a rules-file name)";
+            return;
+        }
+    } else if (!strncmp(buf, "host:", 5)) {
+        kind = FATOM_HOST;
+        arg = buf + 5;
+        f->need_host = 1;
+    }
+    if (!*arg) {
+        fp->err = "empty term";
+        return;
+    }
+
+    for (size_t i = 0; i < f->natoms; i++) {
+        FilterAtom *a = &f->atoms[i];
+        if (a->kind != kind) continue;
+        if ((kind == FATOM_TERM && !strcmp(a->term.lower, arg)) ||
+            (kind == FATOM_CAT && a->cat == cat) ||
+            (kind == FATOM_HOST && !strcmp(a->host_glob, arg))) {
+            fp_emit(fp, FOP_ATOM, (unsigned char)i);
+            return;
+        }
+    }
+    if (f->natoms >= FILTER_MAX_ATOMS) {
+        fp->err = "too many distinct terms";
+        return;
+    }
+
+    FilterAtom *a = &f->atoms[f->natoms];
+    memset(a, 0, sizeof(*a));
+    a->kind = kind;
+    if (kind == FATOM_TERM) {
+        if (!needle_init(&a->term, arg)) fp->err = "out of memory";
+    } else if (kind == FATOM_CAT) {
+        a->cat = cat;
+    } else {
+        a->host_glob = kno_strdup(arg);
+        if (!a->host_glob) fp->err = "out of memory";
+    }
+    if (fp->err) return;
+    fp_emit(fp, FOP_ATOM, (unsigned char)f->natoms);
+    f->natoms++;
+}
+
+static void fp_expr(FilterParser *fp, int depth);
+
+static void fp_unary(FilterParser *fp, int depth) {
+    if (depth > FILTER_MAX_DEPTH) {
+        fp->err = "expression nested too deeply";
+        return;
+    }
+    fp_skip_ws(fp);
+    if (*fp->p == '!') {
+        fp->p++;
+        fp_unary(fp, depth + 1);
+        fp_emit(fp, FOP_NOT, 0);
+    } else if (*fp->p == '(') {
+        fp->p++;
+        fp_expr(fp, depth + 1);
+        fp_skip_ws(fp);
+        if (fp->err) return;
+        if (*fp->p != ')') {
+            fp->err = "missing ')'";
+            return;
+        }
+        fp->p++;
+    } else if (filter_is_word_char(*fp->p)) {
+        const char *start = fp->p;
+        while (filter_is_word_char(*fp->p)) fp->p++;
+        fp_atom(fp, start, (size_t)(fp->p - start));
+    } else {
+        fp->err = *fp->p ? "unexpected operator" : "unexpected end of expression";
+    }
+}
+
+static void fp_or(FilterParser *fp, int depth) {
+    fp_unary(fp, depth);
+    for (;;) {
+        fp_skip_ws(fp);
+        if (fp->err || *fp->p != '|') return;
+        fp->p++;
+        fp_unary(fp, depth);
+        fp_emit(fp, FOP_OR, 0);
+    }
+}
+
+static void fp_expr(FilterParser *fp, int depth) {
+    fp_or(fp, depth);
+    for (;;) {
+        fp_skip_ws(fp);
+        if (fp->err || *fp->p != '&') return;
+        fp->p++;
+        fp_or(fp, depth);
+        fp_emit(fp, FOP_AND, 0);
+    }
+}
+
+static void filter_free(Filter *f) {
+    if (!f) return;
+    for (size_t i = 0; i < f->natoms; i++) {
+        needle_free(&f->atoms[i].term);
+        kno_free(f->atoms[i].host_glob);
+    }
+    f->natoms = 0;
+    f->ncode = 0;
+}
+
+/* Compile src into f. Returns NULL on success, or a message describing the error. */
+static const char *filter_compile(Filter *f, const char *src) {
+    FilterParser fp;
+    memset(f, 0, sizeof(*f));
+    fp.p = src;
+    fp.f = f;
+    fp.err = NULL;
+
+    fp_expr(&fp, 0);
+    fp_skip_ws(&fp);
+    if (!fp.err && *fp.p) {
+        fp.err = (*fp.p == ')') ? "unbalanced ')'" : "unexpected input";
+    }
+    if (fp.err) filter_free(f);
+    return fp.err;
+}
+
+/* Case-insensitive glob (* and ?) over a length-delimited string; pat is folded. */
+static int glob_match_fold(const char *pat, const char *s, size_t n) {
+    const char *star = NULL;
+    size_t si = 0, star_si = 0;
+    while (si < n) {
+        if (*pat == '*') {
+            star = pat++;
+            star_si = si;
+        } else if (*pat && (*pat == '?' || (unsigned char)*pat == fold_ascii((unsigned char)s[si]))) {
+            pat++;
+            si++;
+        } else if (star) {
+            pat = star + 1;
+            si = ++star_si;
+        } else {
+            return 0;
+        }
+    }
+    while (*pat == '*') pat++;
+    return *pat == '\0';
+}
+
+static int filter_eval(const Filter *f, const char *u, size_t ulen, int cat) {
+    uint64_t hits = 0;
+    const char *host = NULL;
+    size_t host_len = 0;
+
+    if (f->need_host) host = url_host(u, &host_len);
+    for (size_t i = 0; i < f->natoms; i++) {
+        const FilterAtom *a = &f->atoms[i];
+        int hit;
+        if (a->kind == FATOM_TERM) hit = needle_match(&a->term, u, ulen);
+        else if (a->kind == FATOM_CAT) hit = (cat == a->cat);
+        else hit = glob_match_fold(a->host_glob, host, host_len);
+        if (hit) hits |= (uint64_t)1 << i;
+    }
+
+    /* Bit stack: bit 0 is the top of stack. */
+    uint64_t stack = 0;
+    for (size_t i = 0; i < f->ncode; i++) {
+        const FilterOp *op = &f->code[i];
+        uint64_t top;
+        switch (op->op) {
+        case FOP_ATOM:
+            stack = (stack << 1) | ((hits >> op->atom) & 1);
+            break;
+        case FOP_NOT:
+            stack ^= 1;
+            break;
+        case FOP_AND:
+            top = stack & 1;
+            stack >>= 1;
+            stack &= ~(uint64_t)1 | top;
+            break;
+        case FOP_OR:
+            top = stack & 1;
+            stack >>= 1;
+            stack |= top;
+            break;
+        }
+    }
+    return (int)(stack & 1);
+}
+
+/* ---------- Sorting by extension ---------- */
+typedef struct {
+    char *url;
+    const char *ext;
+} UrlWithExt;
+
+static int cmp_uwe(const void *a, const void *b) {
+    const UrlWithExt *ua = (const UrlWithExt *)a;
+    const UrlWithExt *ub = (const UrlWithExt *)b;
+    int c = strcmp(ua->ext, ub->ext);
+    if (c != 0) return c;
+    return strcmp(ua->url, ub->url);
+}
+
+/* ---------- Duration parsing (1h30m, 90s, etc.) ---------- */
+static long parse_duration_seconds(const char *s) {
+    if (!s || !*s) return -1;
+    char buf[128];
+    size_t bi = 0;
+    for (size_t i = 0; s[i] && bi < sizeof(buf) - 1; i++) {
+        if (!isspace((unsigned char)s[i])) {
+            buf[bi++] = (char)tolower((unsigned char)s[i]);
+        }
+    }
+    buf[bi] = '\0';
+    if (!buf[0]) return -1;
+
+    int all_digits = 1;
+    for (size_t i = 0; buf[i]; i++) {
+        if (!isdigit((unsigned char)buf[i])) {
+            all_digits = 0;
+            break;
+        }
+    }
+    if (all_digits) {
+        return atol(buf);
+    }
+
+    long total = 0;
+    size_t i = 0;
+    while (buf[i]) {
+        if (!isdigit((unsigned char)buf[i])) return -1;
+        long val = 0;
+        while (isdigit((unsigned char)buf[i])) {
+            val = val * 10 + (buf[i] - '0');
+            i++;
+        }
+        char unit = buf[i];
+        if (unit == 'h') {
+            total += val * 3600;
+            i++;
+        } else if (unit == 'm') {
+            total += val * 60;
+            i++;
+        } else if (unit == 's' || unit == '\0') {
+            total += val;
+            if (unit == 's') i++;
+        } else {
+            return -1;
+        }
+    }
+    return (total > 0) ? total : -1;
+}
+
+/* ---------- Local state (.kno-url next to the executable) ---------- */
+/* Path of .kno-url/<name> (or the directory itself for name == NULL); NULL without argv[0]. */
+static char *kno_state_path(const char *name) {
+    if (!g_exe_path) return NULL;
+    char *path_copy = kno_strdup(g_exe_path);
+    if (!path_copy) return NULL;
+    char *last_sep = NULL;
+    for (char *p = path_copy; *p; p++) {
+        if (*p == '/' || *p == '\\') last_sep = p;
+    }
+    if (last_sep) {
+        *last_sep = '\0';
+    } else {
+        strcpy(path_copy, ".");
+    }
+
+    size_t len = strlen(path_copy) + strlen("/.kno-url/") + (name ? strlen(name) : 0) + 1;
+    char *path = (char *)kno_malloc(len);
+    if (path) snprintf(path, len, name ? "%s/.kno-url/%s" : "%s/.kno-url", path_copy, name ? name : "");
+    kno_free(path_copy);
+    return path;
+}
+
+/* Files the scraper itself writes under .kno-url; night-ops removes them before the directory. */
+static const char *k_state_files[] = {"dns-cache", "tls-sessions"};
+
+/* ---------- Night Ops cleanup ---------- */
+static void night_ops_cleanup(void) {
+    printf("[*] --night-ops: attempting local cleanup...\n");
+    /* net_cleanup runs after this on exit; with nothing cached it won't recreate tls-sessions. */
+    tls_resume_discard();
+
+    if (g_exe_path) {
+        for (size_t i = 0; i < sizeof(k_state_files) / sizeof(k_state_files[0]); i++) {
+            char *file = kno_state_path(k_state_files[i]);
+            if (file && remove(file) == 0) printf("[*] Removed %s\n", file);
+            kno_free(file);
+        }
+        char *kno_dir = kno_state_path(NULL);
+        if (kno_dir) {
+            struct stat st;
+            if (stat(kno_dir, &st) == 0 && (st.st_mode & S_IFDIR)) {
+                if (rmdir(kno_dir) == 0) {
+                    printf("[*] Removed directory %s (if empty).\n", kno_dir);
+                } else {
+                    printf("[!] Could not remove directory (might not be empty): %s\n", kno_dir);
+                }
+            }
+            kno_free(kno_dir);
+        }
+
+        if (remove(g_exe_path) == 0) {
+            printf("[*] Removed executable %s\n", g_exe_path);
+        } else {
+            printf("[!] Could not delete executable (possibly in use): %s\n", g_exe_path);
+        }
+    }
+
+    printf("[+] Self-destruct complete. Exiting.\n");
+}
+
+/* ---------- HTML mode core ---------- */
+typedef struct {
+    int selected[CAT_BUILTIN_COUNT];
+    int have_cat_flags;
+    int no_media_mode;
+    int full_mode;
+    const char *output_file;
+    Needle *needles;
+    size_t nneedles;
+    Filter filter;
+    int have_filter;
+    int stats;
+    const char *trace_file;
+    const char *input_file;
+    const char *metrics_addr;
+    const char *batch_file;
+    long concurrency;
+    long report_interval;   /* seconds between batch latency reports, 0 = off */
+    long host_conns;        /* connections per host, 0 = unlimited */
+    long h2_streams;        /* concurrent HTTP/2 streams per connection */
+    int no_prewarm;
+    int no_header_urls;     /* ignore URLs in response headers */
+    long max_redirs;        /* redirects followed per fetch, 0 = none */
+    long dns_ttl;           /* seconds a prewarmed address stays in .kno-url/dns-cache */
+    int probe;              /* HEAD-probe the in-scope URLs listed */
+    long probe_concurrency; /* probes in flight */
+    long retries;           /* per transfer, 0 = none */
+    double retry_budget;    /* retries per first attempt, see RetryPolicy */
+    FetchLimits limits;     /* --connect-timeout, --timeout */
+} HtmlOptions;
+
+static void html_options_free(HtmlOptions *o) {
+    for (size_t i = 0; i < o->nneedles; i++) needle_free(&o->needles[i]);
+    kno_free(o->needles);
+    o->needles = NULL;
+    o->nneedles = 0;
+    if (o->have_filter) filter_free(&o->filter);
+    o->have_filter = 0;
+}
+
+/* Flags that take the next token as their value. */
+static const char *k_value_flags[] = {
+    "-o", "--search", "--filter", "--trace", "--input", "--metrics", "--batch", "--concurrency",
+    "--report-every", "--host-conns", "--h2-streams", "--dns-ttl", "--max-redirs", "--probe-concurrency",
+    "--retries", "--retry-budget", "--connect-timeout", "--timeout"
+};
+
+static int is_value_flag(const char *arg) {
+    for (size_t k = 0; k < sizeof(k_value_flags) / sizeof(k_value_flags[0]); k++) {
+        if (strcmp(arg, k_value_flags[k]) == 0) return 1;
+    }
+    return 0;
+}
+
+/* Parse HTML-mode flags and compile --search / --filter once. Returns 0 on error. */
+static int html_options_parse(HtmlOptions *o, char **args, int argc) {
+    StrList search_terms; sl_init(&search_terms);
+    struct MemoryBuffer filter_src = { NULL, 0 };  /* every --filter token, space-joined */
+    int ok = 1;
+
+    memset(o, 0, sizeof(*o));
+    o->concurrency = 8;
+    o->report_interval = 10;
+    o->h2_streams = 100;
+    o->dns_ttl = 300;
+    o->max_redirs = FETCH_MAX_REDIRS;
+    o->probe_concurrency = 64;
+    o->retries = RETRY_DEFAULT;
+    o->retry_budget = RETRY_DEFAULT_RATIO;
+    o->limits = k_fetch_limits_default;
+
+    for (int i = 0; i < argc; i++) {
+        if (i + 1 == argc && is_value_flag(args[i])) {
+            printf("Error: %s needs a value.\n", args[i]);
+            ok = 0;
+            break;
+        }
+        if (strcmp(args[i], "-s") == 0) o->selected[CAT_SCRIPTS] = 1;
+        else if (strcmp(args[i], "-md") == 0) o->selected[CAT_MEDIA] = 1;
+        else if (strcmp(args[i], "-a") == 0) o->selected[CAT_API] = 1;
+        else if (strcmp(args[i], "-d") == 0) o->selected[CAT_DOCS] = 1;
+        else if (strcmp(args[i], "-ht") == 0) o->selected[CAT_HTML] = 1;
+        else if (strcmp(args[i], "-O") == 0) o->selected[CAT_OTHER] = 1;
+        else if (strcmp(args[i], "--no-media") == 0) o->no_media_mode = 1;
+        else if (strcmp(args[i], "-o") == 0 && i + 1 < argc) {
+            o->output_file = args[i + 1];
+            i++;
+        } else if (strcmp(args[i], "--search") == 0 && i + 1 < argc) {
+            /* Split by hand: strtok is not reentrant and --serve workers parse concurrently. */
+            for (char *tok = args[i + 1], *comma; tok; tok = comma ? comma + 1 : NULL) {
+                comma = strchr(tok, ',');
+                if (comma) *comma = '\0';
+                while (*tok && isspace((unsigned char)*tok)) tok++;
+                if (*tok) sl_add(&search_terms, tok);
+            }
+            i++;
+        } else if (strcmp(args[i], "--filter") == 0 && i + 1 < argc) {
+            /* Unquoted expressions arrive as several tokens; rejoin them. */
+            int j = i + 1;
+            while (j < argc && (j == i + 1 || args[j][0] != '-')) {
+                size_t n = strlen(args[j]);
+                if ((filter_src.size && write_callback(" ", 1, 1, &filter_src) != 1) ||
+                    write_callback(args[j], 1, n, &filter_src) != n) {
+                    printf("Error: out of memory reading --filter.\n");
+                    ok = 0;
+                }
+                j++;
+            }
+            i = j - 1;
+        } else if (strcmp(args[i], "--full") == 0) {
+            o->full_mode = 1;
+        } else if (strcmp(args[i], "--stats") == 0) {
+            o->stats = 1;
+        } else if (strcmp(args[i], "--trace") == 0 && i + 1 < argc) {
+            o->trace_file = args[++i];
+        } else if (strcmp(args[i], "--input") == 0 && i + 1 < argc) {
+            o->input_file = args[++i];
+        } else if (strcmp(args[i], "--metrics") == 0 && i + 1 < argc) {
+            o->metrics_addr = args[++i];
+        } else if (strcmp(args[i], "--batch") == 0 && i + 1 < argc) {
+            o->batch_file = args[++i];
+        } else if (strcmp(args[i], "--concurrency") == 0 && i + 1 < argc) {
+            o->concurrency = atol(args[++i]);
+            if (o->concurrency < 1) {
+                printf("Error: --concurrency must be at least 1.\n");
+                ok = 0;
+            }
+        } else if (strcmp(args[i], "--host-conns") == 0 && i + 1 < argc) {
+            o->host_conns = atol(args[++i]);
+            if (o->host_conns < 0) {
+                printf("Error: --host-conns must be 0 (unlimited) or more.\n");
+                ok = 0;
+            }
+        } else if (strcmp(args[i], "--h2-streams") == 0 && i + 1 < argc) {
+            o->h2_streams = atol(args[++i]);
+            if (o->h2_streams < 1) {
+                printf("Error: --h2-streams must be at least 1.\n");
+                ok = 0;
+            }
+        } else if (strcmp(args[i], "--no-header-urls") == 0) {
+            o->no_header_urls = 1;
+        } else if (strcmp(args[i], "--max-redirs") == 0 && i + 1 < argc) {
+            o->max_redirs = atol(args[++i]);
+            if (o->max_redirs < 0) {
+                printf("Error: --max-redirs must be 0 (do not follow) or more.\n");
+                ok = 0;
+            }
+        } else if (strcmp(args[i], "--probe") == 0) {
+            o->probe = 1;
+        } else if (strcmp(args[i], "--probe-concurrency") == 0 && i + 1 < argc) {
+            o->probe_concurrency = atol(args[++i]);
+            if (o->probe_concurrency < 1) {
+                printf("Error: --probe-concurrency must be at least 1.\n");
+                ok = 0;
+            }
+        } else if (strcmp(args[i], "--retries") == 0 && i + 1 < argc) {
+            o->retries = atol(args[++i]);
+            if (o->retries < 0) {
+                printf("Error: --retries must be 0 (no retries) or more.\n");
+                ok = 0;
+            }
+        } else if (strcmp(args[i], "--retry-budget") == 0 && i + 1 < argc) {
+            char *end;
+            o->retry_budget = strtod(args[++i], &end);
+            /* Written so NaN fails too; atof would have let "abc" through as 0. */
+            if (end == args[i] || *end || !(o->retry_budget >= 0.0 && o->retry_budget <= 1.0)) {
+                printf("Error: --retry-budget must be a fraction between 0 and 1.\n");
+                ok = 0;
+            }
+        } else if ((strcmp(args[i], "--connect-timeout") == 0 || strcmp(args[i], "--timeout") == 0) &&
+                   i + 1 < argc) {
+            long *dst = args[i][2] == 'c' ? &o->limits.connect_timeout : &o->limits.timeout;
+            i++;
+            *dst = strcmp(args[i], "0") == 0 ? 0 : parse_duration_seconds(args[i]);
+            if (*dst < 0) {
+                printf("Error: invalid %s duration: %s\n", args[i - 1], args[i]);
+                ok = 0;
+            }
+        } else if (strcmp(args[i], "--no-prewarm") == 0) {
+            o->no_prewarm = 1;
+        } else if (strcmp(args[i], "--dns-ttl") == 0 && i + 1 < argc) {
+            i++;
+            o->dns_ttl = strcmp(args[i], "0") == 0 ? 0 : parse_duration_seconds(args[i]);
+            if (o->dns_ttl < 0) {
+                printf("Error: invalid --dns-ttl duration: %s\n", args[i]);
+                ok = 0;
+            }
+        } else if (strcmp(args[i], "--report-every") == 0 && i + 1 < argc) {
+            i++;
+            o->report_interval = strcmp(args[i], "0") == 0 ? 0 : parse_duration_seconds(args[i]);
+            if (o->report_interval < 0) {
+                printf("Error: invalid --report-every duration: %s\n", args[i]);
+                ok = 0;
+            }
+        }
+    }
+
+    for (int c = 0; c < CAT_BUILTIN_COUNT; c++) o->have_cat_flags |= o->selected[c];
+
+    if (ok && search_terms.count > 0) {
+        o->needles = (Needle *)kno_calloc(search_terms.count, sizeof(Needle));
+        if (o->needles) {
+            o->nneedles = search_terms.count;
+            for (size_t st = 0; st < search_terms.count; st++) {
+                needle_init(&o->needles[st], search_terms.items[st]);
+            }
+        }
+    }
+    sl_free(&search_terms);
+
+    if (ok && filter_src.size) {
+        const char *err = filter_compile(&o->filter, filter_src.data);
+        if (err) {
+            printf("Error: invalid --filter expression (%s): %s\n", err, filter_src.data);
+            ok = 0;
+        } else {
+            o->have_filter = 1;
+        }
+    }
+    kno_free(filter_src.data);
+
+    if (!ok) html_options_free(o);
+    return ok;
+}
+
+/*
+ * Search, filter and categorize URLs one at a time, then sort each category
+ * and emit the output lines. render_page() feeds it a page's extracted URLs;
+ * --sitemap feeds it <loc> entries as they stream in.
+ */
+typedef struct {
+    const HtmlOptions *o;
+    RunStats *rs;
+    const HeaderUrls *hdr;  /* header-only URLs, tagged in the output */
+    StrList cats[MAX_CATEGORIES];
+} PageRender;
+
+static void page_render_init(PageRender *pr, const HtmlOptions *o, RunStats *rs) {
+    pr->o = o;
+    pr->rs = rs;
+    pr->hdr = NULL;
+    for (int c = 0; c < g_cat_count; c++) sl_init(&pr->cats[c]);
+}
+
+static void page_render_add(PageRender *pr, const char *u) {
+    const HtmlOptions *o = pr->o;
+    int keep = 1;
+    size_t ulen = strlen(u);
+    if (o->nneedles > 0) {
+        keep = 0;
+        for (size_t st = 0; st < o->nneedles; st++) {
+            if (needle_match(&o->needles[st], u, ulen)) {
+                keep = 1;
+                break;
+            }
+        }
+    }
+    if (!keep) return;
+
+    int cat = categorize_url(u);
+
+    if (o->have_filter && !filter_eval(&o->filter, u, ulen, cat)) return;
+
+    /* Category flags only name built-in categories; rules-file categories are never selected. */
+    int is_selected = cat < CAT_BUILTIN_COUNT && o->selected[cat];
+    if (o->have_cat_flags && !is_selected) return;
+    if (o->no_media_mode && is_selected) return;
+
+    sl_add(&pr->cats[cat], u);
+    pr->rs->urls_kept++;
+}
+
+static void page_render_line(const PageRender *pr, StrList *out_lines, const char *u) {
+    if (pr->hdr) {
+        for (size_t i = 0; i < pr->hdr->urls.count; i++) {
+            if (strcmp(pr->hdr->urls.items[i], u) != 0) continue;
+            char line[MAX_LINE];
+            snprintf(line, sizeof(line), "%s  [%s]", u, pr->hdr->names.items[i]);
+            sl_add(out_lines, line);
+            return;
+        }
+    }
+    sl_add(out_lines, u);
+}
+
+/* Sort and emit every category into out_lines, then release the lists. */
+static void page_render_finish(PageRender *pr, StrList *out_lines) {
+    /* Built-in order, with rules-file categories before OTHER. */
+    int order[MAX_CATEGORIES];
+    int norder = 0;
+    for (int c = 0; c < g_cat_count; c++) {
+        if (c != CAT_OTHER) order[norder++] = c;
+    }
+    order[norder++] = CAT_OTHER;
+
+    for (int oi = 0; oi < norder; oi++) {
+        int c = order[oi];
+        StrList *cl = &pr->cats[c];
+        if (cl->count == 0) continue;
+
+        mem_phase(MEM_SORT);
+        UrlWithExt *with_ext = (UrlWithExt *)kno_calloc(cl->count, sizeof(UrlWithExt));
+        StrList no_ext; sl_init(&no_ext);
+        size_t we_count = 0;
+
+        for (size_t j = 0; j < cl->count; j++) {
+            const char *u = cl->items[j];
+            const char *ext = get_ext(u);
+            if (ext && *ext) {
+                with_ext[we_count].url = (char *)u;
+                with_ext[we_count].ext = ext;
+                we_count++;
+            } else {
+                sl_add(&no_ext, u);
+            }
+        }
+
+        if (we_count > 0) {
+            qsort(with_ext, we_count, sizeof(UrlWithExt), cmp_uwe);
+        }
+
+        mem_phase(MEM_OUTPUT);
+        sl_add(out_lines, g_cat_names[c]);
+        for (size_t j = 0; j < we_count; j++) {
+            page_render_line(pr, out_lines, with_ext[j].url);
+        }
+        for (size_t j = 0; j < no_ext.count; j++) {
+            page_render_line(pr, out_lines, no_ext.items[j]);
+        }
+        sl_add(out_lines, "");
+
+        sl_free(&no_ext);
+        kno_free(with_ext);
+    }
+    for (int c = 0; c < g_cat_count; c++) sl_free(&pr->cats[c]);
+}
+
+/*
+ * Extract, filter, categorize and sort one page into out_lines (category
+ * headers, URLs, blank separators). Phase times and counts go to rs.
+ * hdr (may be NULL) adds the response-header URLs that the body does not already contain.
+ */
+static void render_page(const char *html, size_t len, const HtmlOptions *o, RunStats *rs,
+                        HeaderUrls *hdr, StrList *out_lines) {
+    StrList all_urls; sl_init(&all_urls);
+    stats_phase_begin(rs);
+    mem_phase(MEM_EXTRACT);
+    extract_urls_from_html(html, len, &all_urls);
+    stats_phase_end(rs, PHASE_EXTRACT);
+
+    PageRender pr;
+    size_t hdr_only = 0;    /* header URLs the body does not list; already unique */
+    page_render_init(&pr, o, rs);
+
+    stats_phase_begin(rs);
+    mem_phase(MEM_CATEGORIZE);
+    for (size_t j = 0; j < all_urls.count; j++) page_render_add(&pr, all_urls.items[j]);
+    if (hdr && hdr->urls.count > 0) {
+        /* Drop the ones the body already lists, so a tag always means "only in the headers". */
+        size_t kept = 0;
+        for (size_t i = 0; i < hdr->urls.count; i++) {
+            int in_body = 0;
+            for (size_t j = 0; j < all_urls.count && !in_body; j++) {
+                in_body = strcmp(all_urls.items[j], hdr->urls.items[i]) == 0;
+            }
+            if (in_body) {
+                kno_free(hdr->urls.items[i]);
+                kno_free(hdr->names.items[i]);
+                continue;
+            }
+            hdr->urls.items[kept] = hdr->urls.items[i];
+            hdr->names.items[kept] = hdr->names.items[i];
+            kept++;
+        }
+        hdr->urls.count = hdr->names.count = kept;
+        for (size_t i = 0; i < kept; i++) page_render_add(&pr, hdr->urls.items[i]);
+        pr.hdr = hdr;
+        hdr_only = kept;
+    }
+    stats_phase_end(rs, PHASE_CATEGORIZE);
+
+    stats_phase_begin(rs);
+    page_render_finish(&pr, out_lines);
+    stats_phase_end(rs, PHASE_SORT);
+    mem_phase(MEM_OTHER);
+
+    METRIC_ADD(urls, all_urls.count + hdr_only);
+    if (rs->enabled) {
+        rs->bytes += len;
+        rs->urls_found += all_urls.count + hdr_only;
+        rs->urls_unique += count_unique(all_urls.items, all_urls.count) + hdr_only;
+    }
+
+    sl_free(&all_urls);
+}
+
+/* Read a saved page for --input ("-" = stdin). Returns NULL on error. */
+static char *read_html_file(const char *path, size_t *len) {
+    FILE *f = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+    struct MemoryBuffer buf = { NULL, 0 };
+    char tmp[65536];
+    size_t n;
+    if (!f) {
+        fprintf(stderr, "[-] Could not open %s\n", path);
+        return NULL;
+    }
+    while ((n = fread(tmp, 1, sizeof(tmp), f)) > 0) {
+        if (write_callback(tmp, 1, n, &buf) != n) {
+            kno_free(buf.data);
+            buf.data = NULL;
+            break;
+        }
+    }
+    if (f != stdin) fclose(f);
+    if (!buf.data && buf.size == 0) buf.data = kno_strdup("");
+    *len = buf.size;
+    return buf.data;
+}
+
+/* ---------- Liveness probing (--probe) ---------- */
+/*
+ * --probe checks which of the listed URLs exist. Every kept URL on the
+ * target's host (or a subdomain of it) gets a HEAD request; servers that
+ * refuse HEAD (405, 501) are asked again with a one-byte range GET. All
+ * probes share one multi handle with batch mode's connection settings, so
+ * thousands of assets on one host ride a few reused, multiplexed
+ * connections. Each probed output line gains "[HTTP 200, 5120 bytes, text/css]".
+ */
+#define PROBE_HOST_CONNS 6      /* connections per host when --host-conns is 0 */
+
+typedef struct {
+    char *url;
+    size_t line;            /* index into out_lines */
+} ProbeRef;
+
+typedef struct {
+    const char *url;
+    CURL *easy;
+    int ranged;             /* retried as "Range: bytes=0-0" GET */
+    int got_body;           /* write callback stopped the transfer on purpose */
+    long long total;        /* size from Content-Range, -1 if none */
+    char result[CURL_ERROR_SIZE + 64];
+    char errbuf[CURL_ERROR_SIZE];
+} ProbeJob;
+
+static int cmp_probe_ref(const void *a, const void *b) {
+    return strcmp(((const ProbeRef *)a)->url, ((const ProbeRef *)b)->url);
+}
+
+/* host is scope or one of its subdomains, compared case-insensitively. */
+static int probe_in_scope(const char *host, size_t hl, const char *scope, size_t sl) {
+    if (sl == 0 || hl < sl) return 0;
+    if (hl > sl && host[hl - sl - 1] != '.') return 0;
+    for (size_t i = 0; i < sl; i++) {
+        if (fold_ascii((unsigned char)host[hl - sl + i]) != fold_ascii((unsigned char)scope[i])) return 0;
+    }
+    return 1;
+}
+
+/* Probes never keep a body: the first byte of one ends the transfer. */
+static size_t probe_write(void *contents, size_t size, size_t nmemb, void *userp) {
+    (void)contents;
+    if (size * nmemb > 0) ((ProbeJob *)userp)->got_body = 1;
+    return 0;
+}
+
+static size_t probe_header(char *buf, size_t size, size_t nitems, void *userp) {
+    ProbeJob *j = (ProbeJob *)userp;
+    size_t n = size * nitems;
+    if (n > 5 && memcmp(buf, "HTTP/", 5) == 0) {
+        j->total = -1;      /* a new response (redirect hop) */
+    } else if (n > 14 && fold_ascii((unsigned char)buf[0]) == 'c' && n < 256) {
+        char line[256];
+        memcpy(line, buf, n);
+        line[n] = '\0';
+        for (size_t i = 0; i < 14; i++) line[i] = (char)fold_ascii((unsigned char)line[i]);
+        /* Content-Range: bytes 0-0/12345 */
+        const char *slash = strchr(line, '/');
+        if (strncmp(line, "content-range:", 14) == 0 && slash && isdigit((unsigned char)slash[1])) {
+            j->total = strtoll(slash + 1, NULL, 10);
+        }
+    }
+    return n;
+}
+
+static int probe_start(CURLM *multi, ProbeJob *j, long max_redirs, const FetchLimits *lim) {
+    j->easy = curl_easy_init();
+    if (!j->easy) return 0;
+    fetch_setup_easy(j->easy, j->url, NULL, lim);
+    fetch_setup_multiplexed(j->easy);
+    /* Report the stored size, not that of an encoding picked for us. */
+    curl_easy_setopt(j->easy, CURLOPT_ACCEPT_ENCODING, NULL);
+    curl_easy_setopt(j->easy, CURLOPT_NOBODY, 1L);
+    fetch_setup_redirects(j->easy, max_redirs);
+    curl_easy_setopt(j->easy, CURLOPT_WRITEFUNCTION, probe_write);
+    curl_easy_setopt(j->easy, CURLOPT_WRITEDATA, (void *)j);
+    curl_easy_setopt(j->easy, CURLOPT_HEADERFUNCTION, probe_header);
+    curl_easy_setopt(j->easy, CURLOPT_HEADERDATA, (void *)j);
+    curl_easy_setopt(j->easy, CURLOPT_ERRORBUFFER, j->errbuf);
+    curl_easy_setopt(j->easy, CURLOPT_PRIVATE, (void *)j);
+    j->total = -1;
+    curl_multi_add_handle(multi, j->easy);
+    return 1;
+}
+
+/* Returns 1 if the job was re-queued as a range GET, 0 once it has a result. */
+static int probe_finish(CURLM *multi, ProbeJob *j, CURLcode res, size_t *opened, size_t *reused) {
+    long status = 0, conns = 0;
+    curl_off_t len = -1;
+    char *ctype = NULL;
+
+    curl_multi_remove_handle(multi, j->easy);
+    curl_easy_getinfo(j->easy, CURLINFO_RESPONSE_CODE, &status);
+    curl_easy_getinfo(j->easy, CURLINFO_NUM_CONNECTS, &conns);
+    if (conns > 0) *opened += (size_t)conns;
+    else if (res == CURLE_OK) (*reused)++;
+    if (res == CURLE_WRITE_ERROR && j->got_body) res = CURLE_OK;
+
+    if (res == CURLE_OK && !j->ranged && (status == 405 || status == 501)) {
+        j->ranged = 1;
+        j->got_body = 0;
+        j->total = -1;
+        curl_easy_setopt(j->easy, CURLOPT_HTTPGET, 1L);
+        curl_easy_setopt(j->easy, CURLOPT_RANGE, "0-0");
+        curl_multi_add_handle(multi, j->easy);
+        return 1;
+    }
+
+    if (res != CURLE_OK) {
+        snprintf(j->result, sizeof(j->result), "probe: %s", j->errbuf[0] ? j->errbuf : curl_easy_strerror(res));
+    } else {
+        int n;
+        curl_easy_getinfo(j->easy, CURLINFO_CONTENT_TYPE, &ctype);
+        if (j->ranged && status == 206) len = (curl_off_t)j->total;
+        else curl_easy_getinfo(j->easy, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &len);
+        n = snprintf(j->result, sizeof(j->result), "HTTP %ld", status);
+        if (len >= 0 && n < (int)sizeof(j->result)) {
+            n += snprintf(j->result + n, sizeof(j->result) - (size_t)n, ", %lld bytes", (long long)len);
+        }
+        if (ctype && n < (int)sizeof(j->result)) {
+            size_t cl = strcspn(ctype, "; ");
+            snprintf(j->result + n, sizeof(j->result) - (size_t)n, ", %.*s", (int)cl, ctype);
+        }
+    }
+    curl_easy_cleanup(j->easy);
+    j->easy = NULL;
+    return 0;
+}
+
+/*
+ * Probe the in-scope URL lines of out_lines (as rendered by page_render_finish)
+ * and append each result to its line. scope_url names the host in scope.
+ */
+static void probe_lines(StrList *out_lines, const char *scope_url, const HtmlOptions *o) {
+    size_t sl, nrefs = 0, njobs = 0, skipped = 0, counts[6] = {0};
+    const char *scope = url_host(scope_url, &sl);
+    ProbeRef *refs = (ProbeRef *)kno_calloc(out_lines->count ? out_lines->count : 1, sizeof(ProbeRef));
+    size_t opened = 0, reused = 0;
+    ProbeJob *jobs = NULL;
+
+    if (!refs) return;
+    for (size_t i = 0; i < out_lines->count; i++) {
+        const char *line = out_lines->items[i];
+        if (strncmp(line, "http://", 7) != 0 && strncmp(line, "https://", 8) != 0) continue;
+        const char *tag = strstr(line, "  [");
+        size_t ul = tag ? (size_t)(tag - line) : strlen(line), hl;
+        char *u = (char *)kno_malloc(ul + 1);
+        if (!u) continue;
+        memcpy(u, line, ul);
+        u[ul] = '\0';
+        const char *host = url_host(u, &hl);
+        if (!probe_in_scope(host, hl, scope, sl)) {
+            kno_free(u);
+            skipped++;
+            continue;
+        }
+        refs[nrefs].url = u;
+        refs[nrefs].line = i;
+        nrefs++;
+    }
+    if (nrefs == 0) {
+        printf("[*] Probe: no listed URLs on %.*s (%zu out of scope)\n", (int)sl, scope, skipped);
+        kno_free(refs);
+        return;
+    }
+
+    /* One probe per distinct URL; the sorted refs map results back to lines. */
+    qsort(refs, nrefs, sizeof(ProbeRef), cmp_probe_ref);
+    jobs = (ProbeJob *)kno_calloc(nrefs, sizeof(ProbeJob));
+    CURLM *multi = jobs ? curl_multi_init() : NULL;
+    if (!multi) {
+        fprintf(stderr, "[-] Failed to init CURL multi handle\n");
+        for (size_t i = 0; i < nrefs; i++) kno_free(refs[i].url);
+        kno_free(refs);
+        kno_free(jobs);
+        return;
+    }
+    for (size_t i = 0; i < nrefs; i++) {
+        if (i == 0 || strcmp(refs[i].url, refs[i - 1].url) != 0) jobs[njobs++].url = refs[i].url;
+    }
+
+    printf("[*] Probing %zu URLs on %.*s (%zu out of scope) ...\n", njobs, (int)sl, scope, skipped);
+    fetch_setup_multi(multi, o->host_conns > 0 ? o->host_conns : PROBE_HOST_CONNS, o->h2_streams);
+    double started = mono_ms();
+    size_t next = 0, in_flight = 0;
+    while (next < njobs || in_flight > 0) {
+        while (in_flight < (size_t)o->probe_concurrency && next < njobs) {
+            ProbeJob *j = &jobs[next++];
+            if (probe_start(multi, j, o->max_redirs, &o->limits)) {
+                in_flight++;
+            } else {
+                snprintf(j->result, sizeof(j->result), "probe: could not start");
+            }
+        }
+
+        int running = 0;
+        curl_multi_perform(multi, &running);
+
+        CURLMsg *msg;
+        int left;
+        while ((msg = curl_multi_info_read(multi, &left)) != NULL) {
+            if (msg->msg != CURLMSG_DONE) continue;
+            ProbeJob *j = NULL;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **)&j);
+            if (!probe_finish(multi, j, msg->data.result, &opened, &reused)) in_flight--;
+        }
+        if (in_flight > 0) curl_multi_poll(multi, NULL, 0, 100, NULL);
+    }
+    curl_multi_cleanup(multi);
+
+    /* Append each result to its line(s). */
+    for (size_t i = 0, k = 0; i < nrefs; i++) {
+        if (i > 0 && strcmp(refs[i].url, refs[i - 1].url) != 0) k++;
+        const ProbeJob *j = &jobs[k];
+        char **item = &out_lines->items[refs[i].line];
+        size_t need = strlen(*item) + strlen(j->result) + 5;
+        char *line = (char *)kno_malloc(need);
+        if (line) {
+            snprintf(line, need, "%s  [%s]", *item, j->result);
+            kno_free(*item);
+            *item = line;
+        }
+        kno_free(refs[i].url);
+    }
+    for (size_t k = 0; k < njobs; k++) {
+        long status = strncmp(jobs[k].result, "HTTP ", 5) == 0 ? atol(jobs[k].result + 5) : 0;
+        counts[status >= 100 && status < 600 ? status / 100 : 0]++;
+    }
+    printf("[*] Probe: %zu URLs in %.2f s: %zu 2xx, %zu 3xx, %zu 4xx, %zu 5xx, %zu failed; "
+           "%zu connections opened, %zu probes on reused ones\n",
+           njobs, (mono_ms() - started) / 1000.0, counts[2], counts[3], counts[4], counts[5], counts[0] + counts[1],
+           opened, reused);
+    kno_free(refs);
+    kno_free(jobs);
+}
+
+/* One page from url (or --input). Returns 0 on success. */
+/* Print the rendered lines, and with -o also write them to that file. */
+static void write_out_lines(const StrList *out_lines, const HtmlOptions *o) {
+    if (out_lines->count == 0) {
+        printf("[*] No URLs matched filters.\n");
+        return;
+    }
+    for (size_t j = 0; j < out_lines->count; j++) {
+        printf("%s\n", out_lines->items[j]);
+    }
+    if (o->output_file) {
+        FILE *f = fopen(o->output_file, "w");
+        if (f) {
+            for (size_t j = 0; j < out_lines->count; j++) {
+                fputs(out_lines->items[j], f);
+                fputc('\n', f);
+            }
+            fclose(f);
+            printf("[*] Results written to %s\n", o->output_file);
+        } else {
+            fprintf(stderr, "[-] Failed to write to %s\n", o->output_file);
+        }
+    }
+}
+
+static int run_html_mode(const char *url, char **args, int argc) {
+    HtmlOptions o;
+    RunStats rs;
+    HeaderUrls hdr;
+    RetryPolicy retry;
+
+    header_urls_init(&hdr);
+    if (!html_options_parse(&o, args, argc)) return 1;
+    if (o.probe && o.input_file) {
+        printf("Error: --probe needs a target URL to scope to and cannot be combined with --input.\n");
+        html_options_free(&o);
+        return 1;
+    }
+    hdr.header_urls = !o.no_header_urls;
+    hdr.max_redirs = o.max_redirs;
+    memset(&rs, 0, sizeof(rs));
+    rs.enabled = o.stats;
+    rs.chain = &hdr.chain;
+    tls_counts_reset();
+    rs.hw = rs.enabled && hw_open();
+    if (rs.enabled) mem_reset();
+    rs.trace = o.trace_file != NULL;
+    if (rs.trace) trace_begin();
+
+    char *html;
+    size_t html_len = 0;
+    if (o.input_file) {
+        html = read_html_file(o.input_file, &html_len);
+        rs.fetch.bytes = (double)html_len;
+        url = o.input_file;
+    } else {
+        printf("[*] Fetching HTML from %s ...\n", url);
+        double fetch_start = mono_ms();
+        if (rs.hw) hw_begin();
+        retry_policy_init(&retry, o.retries, o.retry_budget);
+        html = fetch_html(url, (rs.enabled || rs.trace) ? &rs.fetch : NULL, &hdr, &retry, &o.limits);
+        if (rs.hw) hw_end(&rs.hw_phase[HW_SLOT_FETCH]);
+        if (html && rs.trace) trace_fetch(url, fetch_start, &rs.fetch);
+        if (html) html_len = strlen(html);
+    }
+    if (!html) {
+        if (rs.trace) trace_write(o.trace_file);
+        header_urls_free(&hdr);
+        html_options_free(&o);
+        return 1;
+    }
+
+    if (o.full_mode) {
+        if (o.output_file) {
+            FILE *f = fopen(o.output_file, "w");
+            if (f) {
+                fputs(html, f);
+                fclose(f);
+                printf("[*] Full HTML written to %s\n", o.output_file);
+            } else {
+                fprintf(stderr, "[-] Failed to write to %s\n", o.output_file);
+            }
+        }
+        printf("%s\n", html);
+        if (rs.enabled) {
+            stats_print_fetch(&rs.fetch);
+            stats_print_hops(&hdr.chain);
+        }
+        if (rs.trace) trace_write(o.trace_file);
+        kno_free(html);
+        header_urls_free(&hdr);
+        html_options_free(&o);
+        return 0;
+    }
+
+    StrList out_lines; sl_init(&out_lines);
+    render_page(html, html_len, &o, &rs, &hdr, &out_lines);
+    if (o.probe) probe_lines(&out_lines, url, &o);
+
+    stats_phase_begin(&rs);
+    write_out_lines(&out_lines, &o);
+    stats_phase_end(&rs, PHASE_OUTPUT);
+
+    if (rs.enabled) stats_print(&rs);
+    if (rs.trace) trace_write(o.trace_file);
+
+    sl_free(&out_lines);
+    header_urls_free(&hdr);
+    html_options_free(&o);
+    kno_free(html);
+    return 0;
+}
+
+/* ---------- Sitemap mode (--sitemap) ---------- */
+/*
+ * <url> --sitemap reads the site's robots.txt, follows its Sitemap: lines
+ * (or /sitemap.xml when there are none) and any sitemap index files, and
+ * passes every <loc> through the page pipeline above. Documents are parsed
+ * as they arrive by a tokenizer with fixed buffers, so a 50 MB sitemap needs
+ * no more parser memory than a small one; only the kept URLs are held, for
+ * the sorted output. Gzipped sitemaps need a -DKNO_ZLIB build (-lz).
+ */
+#define SITEMAP_MAX_DOCS 1000
+#define SITEMAP_LOC_MAX 8192
+
+enum { SM_TEXT, SM_ENTITY, SM_TAG, SM_TAG_NAME, SM_ATTRS, SM_BANG, SM_COMMENT, SM_CDATA, SM_DECL, SM_PI };
+
+typedef struct {
+    int state;
+    int closing;            /* </name> */
+    int quote;              /* open attribute quote, 0 = none */
+    int slash;              /* last attribute byte was '/' (self-closing) */
+    int in_loc;
+    int in_sitemap;         /* inside an index's <sitemap>: <loc> names another sitemap */
+    char tail[2];           /* last two bytes, for -->, ]]> and ?> */
+    char name[64];
+    size_t name_len;
+    char bang[8];
+    size_t bang_len;
+    char ent[12];
+    size_t ent_len;
+    char loc[SITEMAP_LOC_MAX];
+    size_t loc_len;
+    int loc_overflow;
+
+    PageRender *pr;
+    StrList *docs;          /* sitemaps seen so far, in fetch order */
+    size_t urls;
+    size_t bytes;           /* decoded XML bytes */
+    int gz_checked;
+    int gz;
+    int gz_unsupported;
+#ifdef KNO_ZLIB
+    z_stream zs;
+#endif
+} SitemapParser;
+
+static void sm_loc_put(SitemapParser *p, const char *s, size_t n) {
+    if (!p->in_loc) return;
+    if (p->loc_len + n >= sizeof(p->loc)) {
+        p->loc_overflow = 1;
+        return;
+    }
+    memcpy(p->loc + p->loc_len, s, n);
+    p->loc_len += n;
+}
+
+/* Decode the entity collected in p->ent (without '&' and ';') into the <loc> buffer. */
+static void sm_entity(SitemapParser *p) {
+    static const struct { const char *name; char c; } named[] = {
+        {"amp", '&'}, {"lt", '<'}, {"gt", '>'}, {"quot", '"'}, {"apos", '\''}
+    };
+    p->ent[p->ent_len] = '\0';
+    for (size_t i = 0; i < sizeof(named) / sizeof(named[0]); i++) {
+        if (strcmp(p->ent, named[i].name) == 0) {
+            sm_loc_put(p, &named[i].c, 1);
+            return;
+        }
+    }
+    if (p->ent[0] == '#') {
+        char *end;
+        unsigned long cp = (p->ent[1] == 'x' || p->ent[1] == 'X') ? strtoul(p->ent + 2, &end, 16) : strtoul(p->ent + 1, &end, 10);
+        if (*end == '\0' && cp > 0 && cp <= 0x10FFFF) {
+            char u[4];
+            size_t n;
+            if (cp < 0x80) { u[0] = (char)cp; n = 1; }
+            else if (cp < 0x800) { u[0] = (char)(0xC0 | (cp >> 6)); u[1] = (char)(0x80 | (cp & 0x3F)); n = 2; }
+            else if (cp < 0x10000) { u[0] = (char)(0xE0 | (cp >> 12)); u[1] = (char)(0x80 | ((cp >> 6) & 0x3F)); u[2] = (char)(0x80 | (cp & 0x3F)); n = 3; }
+            else { u[0] = (char)(0xF0 | (cp >> 18)); u[1] = (char)(0x80 | ((cp >> 12) & 0x3F)); u[2] = (char)(0x80 | ((cp >> 6) & 0x3F)); u[3] = (char)(0x80 | (cp & 0x3F)); n = 4; }
+            sm_loc_put(p, u, n);
+            return;
+        }
+    }
+    sm_loc_put(p, "&", 1);
+    sm_loc_put(p, p->ent, p->ent_len);
+    sm_loc_put(p, ";", 1);
+}
+
+static void sm_emit(SitemapParser *p) {
+    char *s = p->loc, *e = p->loc + p->loc_len;
+    if (p->loc_overflow) return;
+    while (s < e && isspace((unsigned char)*s)) s++;
+    while (e > s && isspace((unsigned char)e[-1])) e--;
+    if (s == e) return;
+    *e = '\0';
+
+    if (p->in_sitemap) {
+        for (size_t i = 0; i < p->docs->count; i++) {
+            if (strcmp(p->docs->items[i], s) == 0) return;
+        }
+        if (p->docs->count < SITEMAP_MAX_DOCS) sl_add(p->docs, s);
+        return;
+    }
+    page_render_add(p->pr, s);
+    p->urls++;
+}
+
+static void sm_tag(SitemapParser *p, int self_closing) {
+    p->name[p->name_len] = '\0';
+    const char *local = strrchr(p->name, ':');
+    local = local ? local + 1 : p->name;
+
+    if (strcmp(local, "loc") == 0) {
+        if (p->closing) {
+            if (p->in_loc) sm_emit(p);
+            p->in_loc = 0;
+        } else if (!self_closing) {
+            p->in_loc = 1;
+            p->loc_len = 0;
+            p->loc_overflow = 0;
+        }
+    } else if (strcmp(local, "sitemap") == 0) {
+        p->in_sitemap = !p->closing && !self_closing;
+    }
+    p->state = SM_TEXT;
+}
+
+static void sm_feed_xml(SitemapParser *p, const char *buf, size_t n) {
+    p->bytes += n;
+    for (size_t i = 0; i < n; i++) {
+        char c = buf[i];
+        switch (p->state) {
+        case SM_TEXT:
+            if (c == '<') {
+                p->state = SM_TAG;
+                p->closing = 0;
+                p->name_len = 0;
+            } else if (p->in_loc) {
+                if (c == '&') {
+                    p->state = SM_ENTITY;
+                    p->ent_len = 0;
+                } else {
+                    sm_loc_put(p, &c, 1);
+                }
+            }
+            break;
+        case SM_ENTITY:
+            if (c == ';') {
+                sm_entity(p);
+                p->state = SM_TEXT;
+            } else if (c == '<' || c == '&' || isspace((unsigned char)c) || p->ent_len + 1 >= sizeof(p->ent)) {
+                /* Not an entity after all: keep the text and look at c again. */
+                sm_loc_put(p, "&", 1);
+                sm_loc_put(p, p->ent, p->ent_len);
+                p->state = SM_TEXT;
+                i--;
+                continue;
+            } else {
+                p->ent[p->ent_len++] = c;
+            }
+            break;
+        case SM_TAG:
+            if (c == '/' && !p->closing) {
+                p->closing = 1;
+            } else if (c == '!') {
+                p->state = SM_BANG;
+                p->bang_len = 0;
+            } else if (c == '?') {
+                p->state = SM_PI;
+                p->tail[0] = p->tail[1] = 0;
+            } else {
+                p->state = SM_TAG_NAME;
+                i--;
+                continue;
+            }
+            break;
+        case SM_TAG_NAME:
+            if (c == '>') {
+                sm_tag(p, 0);
+            } else if (isspace((unsigned char)c) || c == '/') {
+                p->state = SM_ATTRS;
+                p->quote = 0;
+                p->slash = c == '/';
+            } else if (p->name_len + 1 < sizeof(p->name)) {
+                p->name[p->name_len++] = c;
+            }
+            break;
+        case SM_ATTRS:
+            if (p->quote) {
+                if (c == p->quote) p->quote = 0;
+            } else if (c == '"' || c == '\'') {
+                p->quote = c;
+                p->slash = 0;
+            } else if (c == '>') {
+                sm_tag(p, p->slash);
+            } else if (!isspace((unsigned char)c)) {
+                p->slash = c == '/';
+            }
+            break;
+        case SM_BANG:
+            p->bang[p->bang_len++] = c;
+            if (p->bang_len == 2 && memcmp(p->bang, "--", 2) == 0) {
+                p->state = SM_COMMENT;
+                p->tail[0] = p->tail[1] = 0;
+            } else if (p->bang_len == 7 && memcmp(p->bang, "[CDATA[", 7) == 0) {
+                p->state = SM_CDATA;
+                p->tail[0] = p->tail[1] = 0;
+            } else if (c == '>') {
+                p->state = SM_TEXT;
+            } else if (strncmp(p->bang, "--", p->bang_len < 2 ? p->bang_len : 2) != 0 &&
+                       strncmp(p->bang, "[CDATA[", p->bang_len) != 0) {
+                p->state = SM_DECL;
+            }
+            break;
+        case SM_COMMENT:
+        case SM_CDATA:
+        case SM_PI: {
+            char end = p->state == SM_COMMENT ? '-' : p->state == SM_CDATA ? ']' : 0;
+            if (c == '>' && (end ? (p->tail[0] == end && p->tail[1] == end) : p->tail[1] == '?')) {
+                /* CDATA text went to <loc> as it arrived; drop the "]]" that closed it. */
+                if (p->state == SM_CDATA && p->in_loc && p->loc_len >= 2) p->loc_len -= 2;
+                p->state = SM_TEXT;
+                break;
+            }
+            if (p->state == SM_CDATA) sm_loc_put(p, &c, 1);
+            p->tail[0] = p->tail[1];
+            p->tail[1] = c;
+            break;
+        }
+        case SM_DECL:
+            if (c == '>') p->state = SM_TEXT;
+            break;
+        }
+    }
+}
+
+static size_t sm_write(void *contents, size_t size, size_t nmemb, void *userp) {
+    SitemapParser *p = (SitemapParser *)userp;
+    const unsigned char *data = (const unsigned char *)contents;
+    size_t n = size * nmemb;
+
+    /* .xml.gz files are usually served as-is, without Content-Encoding. */
+    if (!p->gz_checked && n > 0) {
+        p->gz_checked = 1;
+        p->gz = data[0] == 0x1f && (n < 2 || data[1] == 0x8b);
+#ifdef KNO_ZLIB
+        if (p->gz && inflateInit2(&p->zs, 16 + MAX_WBITS) != Z_OK) return 0;
+#else
+        if (p->gz) {
+            p->gz_unsupported = 1;
+            return 0;
+        }
+#endif
+    }
+    if (!p->gz) {
+        sm_feed_xml(p, (const char *)contents, n);
+        return n;
+    }
+#ifdef KNO_ZLIB
+    unsigned char out[65536];
+    p->zs.next_in = (unsigned char *)data;
+    p->zs.avail_in = (uInt)n;
+    while (p->zs.avail_in > 0) {
+        p->zs.next_out = out;
+        p->zs.avail_out = sizeof(out);
+        int zr = inflate(&p->zs, Z_NO_FLUSH);
+        if (zr != Z_OK && zr != Z_STREAM_END && zr != Z_BUF_ERROR) return 0;
+        sm_feed_xml(p, (const char *)out, sizeof(out) - p->zs.avail_out);
+        if (zr == Z_STREAM_END) break;
+        if (zr == Z_BUF_ERROR && p->zs.avail_out == sizeof(out)) break;
+    }
+#endif
+    return n;
+}
+
+/* Parse one sitemap document. Resets the tokenizer but keeps the counters and queue. */
+static int sitemap_fetch_doc(CURL *curl, const char *url, SitemapParser *p, const FetchLimits *lim) {
+    struct MemoryBuffer unused = { NULL, 0 };
+    long status = 0;
+
+    p->state = SM_TEXT;
+    p->in_loc = p->in_sitemap = 0;
+    p->gz_checked = p->gz = p->gz_unsupported = 0;
+    fetch_setup_easy(curl, url, &unused, lim);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, sm_write);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)p);
+    CURLcode res = curl_easy_perform(curl);
+#ifdef KNO_ZLIB
+    if (p->gz) inflateEnd(&p->zs);
+#endif
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+    if (p->gz_unsupported) {
+        fprintf(stderr, "[-] %s is gzipped; rebuild with -DKNO_ZLIB ... -lz to read it\n", url);
+        return 0;
+    }
+    if (res != CURLE_OK) {
+        fprintf(stderr, "[-] CURL error fetching %s: %s\n", url, curl_easy_strerror(res));
+        return 0;
+    }
+    if (status >= 400) {
+        fprintf(stderr, "[-] %s: HTTP %ld\n", url, status);
+        return 0;
+    }
+    return 1;
+}
+
+/* Add the Sitemap: lines of robots.txt at url to docs. */
+static void sitemap_from_robots(CURL *curl, const char *url, StrList *docs, const FetchLimits *lim) {
+    struct MemoryBuffer body = { NULL, 0 };
+    long status = 0;
+
+    fetch_setup_easy(curl, url, &body, lim);
+    if (curl_easy_perform(curl) == CURLE_OK) curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+    if (status == 200 && body.data) {
+        for (char *line = body.data, *next; line; line = next) {
+            next = strchr(line, '\n');
+            if (next) *next++ = '\0';
+            while (isspace((unsigned char)*line)) line++;
+            const char *key = "sitemap:";
+            size_t k = 0;
+            while (key[k] && tolower((unsigned char)line[k]) == key[k]) k++;
+            if (key[k]) continue;
+            char *v = line + k, *e;
+            while (isspace((unsigned char)*v)) v++;
+            e = v + strlen(v);
+            while (e > v && isspace((unsigned char)e[-1])) *--e = '\0';
+            if (*v && docs->count < SITEMAP_MAX_DOCS) sl_add(docs, v);
+        }
+    }
+    kno_free(body.data);
+}
+
+/* Same scheme, host and port as url, with path replaced; NULL on a bad URL. */
+static char *url_with_path(const char *url, const char *path) {
+    CURLU *h = curl_url();
+    char *out = NULL, *tmp = NULL;
+    if (h && curl_url_set(h, CURLUPART_URL, url, 0) == CURLUE_OK &&
+        curl_url_set(h, CURLUPART_PATH, path, 0) == CURLUE_OK &&
+        curl_url_set(h, CURLUPART_QUERY, NULL, 0) == CURLUE_OK &&
+        curl_url_set(h, CURLUPART_FRAGMENT, NULL, 0) == CURLUE_OK &&
+        curl_url_get(h, CURLUPART_URL, &tmp, 0) == CURLUE_OK) {
+        out = kno_strdup(tmp);
+    }
+    curl_free(tmp);
+    curl_url_cleanup(h);
+    return out;
+}
+
+static int run_sitemap_mode(const char *url, char **args, int argc) {
+    HtmlOptions o;
+    RunStats rs;
+    StrList docs; sl_init(&docs);
+    StrList out_lines; sl_init(&out_lines);
+    PageRender pr;
+    SitemapParser *p;
+    size_t ulen = strlen(url), fetched = 0;
+
+    if (!html_options_parse(&o, args, argc)) return 1;
+    if (o.full_mode || o.input_file) {
+        printf("Error: --sitemap cannot be combined with --full or --input.\n");
+        html_options_free(&o);
+        return 1;
+    }
+    p = (SitemapParser *)kno_calloc(1, sizeof(*p));
+    CURL *curl = net_init() ? curl_easy_init() : NULL;
+    if (!p || !curl) {
+        fprintf(stderr, "[-] Failed to init CURL\n");
+        kno_free(p);
+        html_options_free(&o);
+        return 1;
+    }
+    memset(&rs, 0, sizeof(rs));
+    rs.enabled = o.stats;
+    tls_counts_reset();
+    if (rs.enabled) mem_reset();
+    /* Sitemaps and robots.txt commonly redirect to the canonical host. */
+    fetch_setup_redirects(curl, o.max_redirs);
+
+    /* A URL that already names a sitemap is read directly; otherwise start from robots.txt. */
+    if ((ulen > 4 && strcmp(url + ulen - 4, ".xml") == 0) || (ulen > 7 && strcmp(url + ulen - 7, ".xml.gz") == 0)) {
+        sl_add(&docs, url);
+    } else {
+        char *robots = url_with_path(url, "/robots.txt");
+        if (robots) {
+            printf("[*] Reading %s ...\n", robots);
+            sitemap_from_robots(curl, robots, &docs, &o.limits);
+            kno_free(robots);
+        }
+        if (docs.count == 0) {
+            char *fallback = url_with_path(url, "/sitemap.xml");
+            if (fallback) sl_add(&docs, fallback);
+            kno_free(fallback);
+        }
+    }
+
+    page_render_init(&pr, &o, &rs);
+    p->pr = &pr;
+    p->docs = &docs;
+    double started = mono_ms();
+    /* docs grows while it is walked: index files append the sitemaps they list. */
+    for (size_t i = 0; i < docs.count; i++) {
+        size_t before = p->urls;
+        printf("[*] Sitemap %s ...\n", docs.items[i]);
+        if (sitemap_fetch_doc(curl, docs.items[i], p, &o.limits)) fetched++;
+        if (rs.enabled) {
+            FetchStats fs;
+            memset(&fs, 0, sizeof(fs));
+            fetch_collect_stats(curl, &fs);
+            stats_add_fetch(&rs, &fs);
+        }
+        if (p->urls > before) printf("[*]   %zu URLs\n", p->urls - before);
+    }
+    if (docs.count >= SITEMAP_MAX_DOCS) printf("[!] Stopped at %d sitemaps.\n", SITEMAP_MAX_DOCS);
+    printf("[*] Sitemap: %zu of %zu documents read, %zu URLs, %.1f MB of XML in %.2f s\n",
+           fetched, docs.count, p->urls, (double)p->bytes / 1e6, (mono_ms() - started) / 1000.0);
+
+    stats_phase_begin(&rs);
+    page_render_finish(&pr, &out_lines);
+    stats_phase_end(&rs, PHASE_SORT);
+    if (o.probe) probe_lines(&out_lines, url, &o);
+
+    stats_phase_begin(&rs);
+    write_out_lines(&out_lines, &o);
+    stats_phase_end(&rs, PHASE_OUTPUT);
+
+    if (rs.enabled) {
+        rs.bytes = p->bytes;
+        rs.urls_found = p->urls;
+        stats_print(&rs);
+    }
+
+    curl_easy_cleanup(curl);
+    kno_free(p);
+    sl_free(&out_lines);
+    sl_free(&docs);
+    html_options_free(&o);
+    return fetched ? 0 : 1;
+}
+
+/* ---------- DNS prewarm (batch) ---------- */
+/*
+ * Before a batch starts, every distinct host:port in the target list is
+ * resolved on a small thread pool, so no transfer pays for a blocking lookup
+ * on its own critical path. Each transfer gets its host's addresses as a
+ * CURLOPT_RESOLVE entry, which seeds the multi handle's DNS cache. Results
+ * are kept in .kno-url/dns-cache, one "host port expires addr,addr" line per
+ * host. getaddrinfo does not report record TTLs, so entries live for
+ * --dns-ttl seconds; --dns-ttl 0 resolves afresh and leaves the file alone.
+ */
+#define DNS_MAX_ADDRS 4
+#define DNS_MAX_THREADS 16
+
+typedef struct {
+    char *host;
+    long port;
+    long long expires;      /* unix time */
+    char *addrs;            /* "a,[b]" as CURLOPT_RESOLVE takes them, NULL = unresolved */
+    int wanted;             /* a batch target; others are cache lines carried over */
+    int cached;
+} DnsEntry;
+
+typedef struct {
+    DnsEntry *items;
+    size_t count;
+    size_t cap;
+} DnsTable;
+
+static DnsTable g_hosts_table;      /* parsed --hosts-map, sorted; see hosts_map_load() */
+
+static void dns_table_free(DnsTable *t) {
+    for (size_t i = 0; i < t->count; i++) {
+        kno_free(t->items[i].host);
+        kno_free(t->items[i].addrs);
+    }
+    kno_free(t->items);
+    memset(t, 0, sizeof(*t));
+}
+
+static DnsEntry *dns_add(DnsTable *t, const char *host, long port) {
+    if (t->count == t->cap) {
+        size_t cap = t->cap ? t->cap * 2 : 16;
+        DnsEntry *items = (DnsEntry *)kno_realloc(t->items, cap * sizeof(DnsEntry));
+        if (!items) return NULL;
+        t->items = items;
+        t->cap = cap;
+    }
+    DnsEntry *e = &t->items[t->count];
+    memset(e, 0, sizeof(*e));
+    e->host = kno_strdup(host);
+    if (!e->host) return NULL;
+    e->port = port;
+    t->count++;
+    return e;
+}
+
+static int dns_cmp(const void *a, const void *b) {
+    const DnsEntry *x = (const DnsEntry *)a, *y = (const DnsEntry *)b;
+    int c = strcmp(x->host, y->host);
+    return c ? c : (x->port > y->port) - (x->port < y->port);
+}
+
+static DnsEntry *dns_find(const DnsTable *t, const char *host, long port) {
+    DnsEntry key;
+    key.host = (char *)host;
+    key.port = port;
+    return t->count ? (DnsEntry *)bsearch(&key, t->items, t->count, sizeof(DnsEntry), dns_cmp) : NULL;
+}
+
+#ifndef _WIN32
+/* Lower-cased host and effective port of url; 0 for IP literals and unparsable URLs. */
+static int url_host_port(const char *url, char *host, size_t cap, long *port) {
+    CURLU *h = curl_url();
+    char *hp = NULL, *pp = NULL;
+    int ok = 0;
+
+    if (!h) return 0;
+    if (curl_url_set(h, CURLUPART_URL, url, 0) == CURLUE_OK &&
+        curl_url_get(h, CURLUPART_HOST, &hp, 0) == CURLUE_OK &&
+        curl_url_get(h, CURLUPART_PORT, &pp, CURLU_DEFAULT_PORT) == CURLUE_OK &&
+        hp[0] != '[' && strlen(hp) < cap) {
+        unsigned char v4[4];
+        if (inet_pton(AF_INET, hp, v4) != 1) {
+            for (size_t i = 0; hp[i]; i++) host[i] = (char)tolower((unsigned char)hp[i]);
+            host[strlen(hp)] = '\0';
+            *port = atol(pp);
+            ok = 1;
+        }
+    }
+    curl_free(hp);
+    curl_free(pp);
+    curl_url_cleanup(h);
+    return ok;
+}
+
+/*
+ * CURLOPT_RESOLVE list for one transfer (the --hosts-map entries plus its
+ * prewarmed host), or NULL when its host was not prewarmed.
+ */
+static struct curl_slist *dns_resolve_for(const DnsTable *t, const char *url) {
+    char host[256], line[512];
+    long port;
+    if (!t->count || !url_host_port(url, host, sizeof(host), &port)) return NULL;
+    const DnsEntry *e = dns_find(t, host, port);
+    if (!e || !e->addrs) return NULL;
+
+    struct curl_slist *list = NULL, *next;
+    for (const struct curl_slist *m = g_hosts_map; m; m = m->next) {
+        if (!(next = curl_slist_append(list, m->data))) break;
+        list = next;
+    }
+    snprintf(line, sizeof(line), "%s:%ld:%s", e->host, e->port, e->addrs);
+    if ((next = curl_slist_append(list, line))) list = next;
+    return list;
+}
+
+static void dns_cache_load(DnsTable *t, long long now) {
+    char *path = kno_state_path("dns-cache");
+    FILE *f = path ? fopen(path, "r") : NULL;
+    char line[MAX_LINE], host[256], addrs[1024];
+    size_t wanted = t->count;
+    long port;
+    long long expires;
+
+    kno_free(path);
+    if (!f) return;
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "%255s %ld %lld %1023s", host, &port, &expires, addrs) != 4) continue;
+        if (expires <= now) continue;
+        DnsEntry key;
+        key.host = host;
+        key.port = port;
+        DnsEntry *e = (DnsEntry *)bsearch(&key, t->items, wanted, sizeof(DnsEntry), dns_cmp);
+        if (!e) e = dns_add(t, host, port);
+        if (!e || e->addrs) continue;
+        e->addrs = kno_strdup(addrs);
+        e->expires = expires;
+        e->cached = 1;
+    }
+    fclose(f);
+    qsort(t->items, t->count, sizeof(DnsEntry), dns_cmp);
+}
+
+static void dns_cache_save(const DnsTable *t) {
+    char *dir = kno_state_path(NULL);
+    char *path = kno_state_path("dns-cache");
+    char *tmp = path ? (char *)kno_malloc(strlen(path) + 5) : NULL;
+    FILE *f;
+
+    if (dir) mkdir(dir, 0700);
+    if (tmp) {
+        sprintf(tmp, "%s.tmp", path);
+        f = fopen(tmp, "w");
+        if (f) {
+            for (size_t i = 0; i < t->count; i++) {
+                const DnsEntry *e = &t->items[i];
+                if (e->addrs) fprintf(f, "%s %ld %lld %s\n", e->host, e->port, e->expires, e->addrs);
+            }
+            if (fclose(f) != 0 || rename(tmp, path) != 0) remove(tmp);
+        }
+    }
+    kno_free(tmp);
+    kno_free(path);
+    kno_free(dir);
+}
+
+typedef struct {
+    DnsTable *t;
+    atomic_size_t next;
+    long long expires;
+} DnsPool;
+
+static void dns_resolve_one(DnsEntry *e, long long expires) {
+    struct addrinfo hints, *res = NULL;
+    char buf[DNS_MAX_ADDRS * (INET6_ADDRSTRLEN + 3)], addr[INET6_ADDRSTRLEN];
+    size_t len = 0;
+    int n = 0;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(e->host, NULL, &hints, &res) != 0) return;
+    buf[0] = '\0';
+    for (struct addrinfo *ai = res; ai && n < DNS_MAX_ADDRS; ai = ai->ai_next) {
+        const void *src = ai->ai_family == AF_INET6
+            ? (const void *)&((struct sockaddr_in6 *)ai->ai_addr)->sin6_addr
+            : (const void *)&((struct sockaddr_in *)ai->ai_addr)->sin_addr;
+        if ((ai->ai_family != AF_INET && ai->ai_family != AF_INET6) ||
+            !inet_ntop(ai->ai_family, src, addr, sizeof(addr))) continue;
+        len += (size_t)snprintf(buf + len, sizeof(buf) - len, ai->ai_family == AF_INET6 ? "%s[%s]" : "%s%s",
+                                n ? "," : "", addr);
+        n++;
+    }
+    freeaddrinfo(res);
+    if (n) {
+        e->addrs = kno_strdup(buf);
+        e->expires = expires;
+    }
+}
+
+static void *dns_worker(void *arg) {
+    DnsPool *pool = (DnsPool *)arg;
+    size_t i;
+    while ((i = atomic_fetch_add(&pool->next, 1)) < pool->t->count) {
+        DnsEntry *e = &pool->t->items[i];
+        if (e->wanted && !e->addrs) dns_resolve_one(e, pool->expires);
+    }
+    return NULL;
+}
+
+static void dns_prewarm(const StrList *targets, long ttl, DnsTable *t) {
+    char host[256];
+    long port;
+    double t0 = mono_ms();
+    long long now = (long long)time(NULL);
+    size_t wanted = 0, cached = 0, resolved = 0, failed = 0;
+
+    for (size_t i = 0; i < targets->count; i++) {
+        if (!url_host_port(targets->items[i], host, sizeof(host), &port)) continue;
+        if (dns_find(&g_hosts_table, host, port)) continue;     /* pinned by --hosts-map */
+        DnsEntry *e = dns_add(t, host, port);
+        if (e) e->wanted = 1;
+    }
+    qsort(t->items, t->count, sizeof(DnsEntry), dns_cmp);
+    for (size_t i = 0; i < t->count; i++) {
+        if (wanted && dns_cmp(&t->items[wanted - 1], &t->items[i]) == 0) {
+            kno_free(t->items[i].host);
+            continue;
+        }
+        t->items[wanted++] = t->items[i];
+    }
+    t->count = wanted;
+    if (!wanted) return;
+
+    if (ttl > 0) dns_cache_load(t, now);
+    for (size_t i = 0; i < t->count; i++) {
+        if (t->items[i].wanted && t->items[i].cached) cached++;
+    }
+
+    DnsPool pool;
+    pthread_t tids[DNS_MAX_THREADS];
+    size_t nthreads = wanted - cached < DNS_MAX_THREADS ? wanted - cached : DNS_MAX_THREADS;
+    size_t started = 0;
+    pool.t = t;
+    atomic_init(&pool.next, 0);
+    pool.expires = now + ttl;
+    for (; started < nthreads; started++) {
+        if (pthread_create(&tids[started], NULL, dns_worker, &pool) != 0) break;
+    }
+    if (nthreads && !started) dns_worker(&pool);
+    for (size_t i = 0; i < started; i++) pthread_join(tids[i], NULL);
+
+    for (size_t i = 0; i < t->count; i++) {
+        const DnsEntry *e = &t->items[i];
+        if (!e->wanted || e->cached) continue;
+        if (e->addrs) resolved++;
+        else failed++;
+    }
+    if (resolved && ttl > 0) dns_cache_save(t);
+    printf("[*] DNS prewarm: %zu hosts (%zu cached, %zu resolved, %zu failed) in %.1f ms\n",
+           wanted, cached, resolved, failed, mono_ms() - t0);
+}
+#else
+static struct curl_slist *dns_resolve_for(const DnsTable *t, const char *url) {
+    (void)t; (void)url;
+    return NULL;
+}
+
+static void dns_prewarm(const StrList *targets, long ttl, DnsTable *t) {
+    (void)targets; (void)ttl; (void)t;
+}
+#endif
+
+/* ---------- Host map (--hosts-map <file>) ---------- */
+/*
+ * Lab targets often have names no resolver knows. --hosts-map pins them to
+ * addresses for every transfer through CURLOPT_RESOLVE, so fetches never go
+ * to DNS for them. Lines are either curl's own "host:port:addr[,addr]" or
+ * /etc/hosts style "addr host [host...]" (ports 80 and 443). Blank lines and
+ * '#' comments are ignored.
+ */
+static int hosts_is_addr(const char *s) {
+    int dot = 0, colon = 0;
+    if (!*s) return 0;
+    for (; *s; s++) {
+        if (*s == '.') dot = 1;
+        else if (*s == ':') colon = 1;
+        else if (!isxdigit((unsigned char)*s)) return 0;
+    }
+    return dot || colon;
+}
+
+static int hosts_map_add(const char *host, long port, const char *addr) {
+    char buf[256];
+    size_t n = strlen(host);
+    if (n >= sizeof(buf)) return 0;
+    for (size_t i = 0; i <= n; i++) buf[i] = (char)tolower((unsigned char)host[i]);
+
+    DnsEntry *e = NULL;
+    for (size_t i = 0; i < g_hosts_table.count && !e; i++) {
+        if (g_hosts_table.items[i].port == port && strcmp(g_hosts_table.items[i].host, buf) == 0) {
+            e = &g_hosts_table.items[i];
+        }
+    }
+    if (!e && !(e = dns_add(&g_hosts_table, buf, port))) return 0;
+
+    size_t old = e->addrs ? strlen(e->addrs) : 0;
+    char *addrs = (char *)kno_realloc(e->addrs, old + strlen(addr) + 2);
+    if (!addrs) return 0;
+    if (old) addrs[old++] = ',';
+    strcpy(addrs + old, addr);
+    e->addrs = addrs;
+    e->wanted = 1;
+    return 1;
+}
+
+static void hosts_map_free(void) {
+    if (g_hosts_map) curl_slist_free_all(g_hosts_map);
+    g_hosts_map = NULL;
+    dns_table_free(&g_hosts_table);
+}
+
+static int hosts_map_load(const char *path) {
+    FILE *f = fopen(path, "r");
+    char line[MAX_LINE], entry[512];
+    int lineno = 0, ok = 1;
+
+    if (!f) {
+        fprintf(stderr, "[-] Could not open hosts map %s\n", path);
+        return 0;
+    }
+    while (ok && fgets(line, sizeof(line), f)) {
+        char *tokens[64];
+        lineno++;
+        char *hash = strchr(line, '#');
+        if (hash) *hash = '\0';
+        int n = split_tokens(line, tokens, 64);
+        if (n == 0) continue;
+
+        char *c1 = strchr(tokens[0], ':');
+        char *c2 = c1 ? strchr(c1 + 1, ':') : NULL;
+        if (n == 1 && c1 && c2 && c2 > c1 + 1 && !hosts_is_addr(tokens[0])) {
+            /* host:port:addr[,addr] */
+            char *end;
+            long port = strtol(c1 + 1, &end, 10);
+            if (end != c2 || port < 1 || port > 65535 || !c2[1]) {
+                fprintf(stderr, "[-] %s:%d: bad entry '%s' (expected host:port:addr)\n", path, lineno, tokens[0]);
+                ok = 0;
+                break;
+            }
+            *c1 = '\0';
+            ok = hosts_map_add(tokens[0], port, c2 + 1);
+        } else if (n >= 2 && hosts_is_addr(tokens[0])) {
+            /* addr host... ; IPv6 addresses go in brackets for CURLOPT_RESOLVE */
+            if (strchr(tokens[0], ':')) snprintf(entry, sizeof(entry), "[%s]", tokens[0]);
+            else snprintf(entry, sizeof(entry), "%s", tokens[0]);
+            for (int i = 1; i < n && ok; i++) {
+                ok = hosts_map_add(tokens[i], 80, entry) && hosts_map_add(tokens[i], 443, entry);
+            }
+        } else {
+            fprintf(stderr, "[-] %s:%d: expected 'host:port:addr' or 'addr host...'\n", path, lineno);
+            ok = 0;
+        }
+    }
+    fclose(f);
+
+    /* The mappings become a curl_slist, so libcurl is needed from here on. */
+    if (ok && !curl_load()) ok = 0;
+    for (size_t i = 0; ok && i < g_hosts_table.count; i++) {
+        const DnsEntry *e = &g_hosts_table.items[i];
+        snprintf(entry, sizeof(entry), "%s:%ld:%s", e->host, e->port, e->addrs);
+        struct curl_slist *next = curl_slist_append(g_hosts_map, entry);
+        if (!next) ok = 0;
+        else g_hosts_map = next;
+    }
+    if (!ok) {
+        hosts_map_free();
+        return 0;
+    }
+    qsort(g_hosts_table.items, g_hosts_table.count, sizeof(DnsEntry), dns_cmp);
+    printf("[*] Loaded %zu host mappings from %s\n", g_hosts_table.count, path);
+    return 1;
+}
+
+/* ---------- Batch mode (--batch <file>) ---------- */
+/*
+ * Every target in the file (one per line, '#' comments) goes through one
+ * curl multi handle with up to --concurrency transfers in flight. Pages are
+ * rendered as they complete, in completion order.
+ */
+typedef struct {
+    char *url;
+    CURL *easy;
+    struct MemoryBuffer body;
+    double started_ms;
+    struct curl_slist *resolve;     /* prewarmed addresses for this host */
+    HeaderUrls hdr;
+    int attempts;           /* retries so far */
+    char errbuf[CURL_ERROR_SIZE];
+} BatchJob;
+
+static int batch_load_targets(const char *path, StrList *targets) {
+    FILE *f = fopen(path, "r");
+    char line[MAX_LINE];
+    if (!f) {
+        fprintf(stderr, "[-] Could not open batch file %s\n", path);
+        return 0;
+    }
+    while (fgets(line, sizeof(line), f)) {
+        char *p = line;
+        while (isspace((unsigned char)*p)) p++;
+        size_t len = strlen(p);
+        while (len > 0 && isspace((unsigned char)p[len - 1])) p[--len] = '\0';
+        if (!*p || *p == '#') continue;
+        char *u = normalize_url(p);
+        if (u) {
+            sl_add(targets, u);
+            kno_free(u);
+        }
+    }
+    fclose(f);
+    return 1;
+}
+
+static int batch_start(CURLM *multi, BatchJob *job, const char *url, const DnsTable *dns, const HtmlOptions *o) {
+    memset(job, 0, sizeof(*job));
+    header_urls_init(&job->hdr);
+    job->url = kno_strdup(url);
+    job->easy = curl_easy_init();
+    if (!job->url || !job->easy) {
+        kno_free(job->url);
+        if (job->easy) curl_easy_cleanup(job->easy);
+        return 0;
+    }
+    fetch_setup_easy(job->easy, job->url, &job->body, &o->limits);
+    fetch_setup_multiplexed(job->easy);
+    job->resolve = dns_resolve_for(dns, job->url);
+    if (job->resolve) curl_easy_setopt(job->easy, CURLOPT_RESOLVE, job->resolve);
+    job->hdr.header_urls = !o->no_header_urls;
+    job->hdr.max_redirs = o->max_redirs;
+    fetch_collect_headers(job->easy, &job->hdr);
+    curl_easy_setopt(job->easy, CURLOPT_ERRORBUFFER, job->errbuf);
+    curl_easy_setopt(job->easy, CURLOPT_PRIVATE, (void *)job);
+    job->started_ms = mono_ms();
+    curl_multi_add_handle(multi, job->easy);
+    return 1;
+}
+
+static void batch_finish(CURLM *multi, BatchJob *job, CURLcode res, const HtmlOptions *o,
+                         RunStats *rs, FILE *out) {
+    FetchStats fs;
+    memset(&fs, 0, sizeof(fs));
+    fetch_collect_stats(job->easy, &fs);
+
+    if (res != CURLE_OK) {
+        METRIC_ADD(errors[metrics_error_type(res)], 1);
+        fprintf(stderr, "[-] CURL error fetching %s: %s\n", job->url,
+                job->errbuf[0] ? job->errbuf : curl_easy_strerror(res));
+    } else {
+        if (fs.status >= 400) METRIC_ADD(errors[ERR_HTTP], 1);
+        METRIC_ADD(pages, 1);
+        METRIC_ADD(bytes, job->body.size);
+        if (rs->trace) trace_fetch(job->url, job->started_ms, &fs);
+        lat_record(job->url, LAT_TTFB, fs.ttfb_ms);
+        lat_record(job->url, LAT_TOTAL, fs.total_ms);
+        if (rs->enabled) stats_add_fetch(rs, &fs);
+
+        const char *html = job->body.data ? job->body.data : "";
+        StrList out_lines; sl_init(&out_lines);
+        double t0 = mono_ms();
+        render_page(html, job->body.size, o, rs, &job->hdr, &out_lines);
+        lat_record(job->url, LAT_PARSE, mono_ms() - t0);
+
+        stats_phase_begin(rs);
+        if (fs.redirects > 0) {
+            char *final_url = NULL;
+            curl_easy_getinfo(job->easy, CURLINFO_EFFECTIVE_URL, &final_url);
+            printf("[+] %s (HTTP %ld, %zu bytes, %ld redirect%s to %s)\n", job->url, fs.status, job->body.size,
+                   fs.redirects, fs.redirects == 1 ? "" : "s", final_url ? final_url : "?");
+        } else {
+            printf("[+] %s (HTTP %ld, %zu bytes)\n", job->url, fs.status, job->body.size);
+        }
+        for (size_t j = 0; j < out_lines.count; j++) {
+            printf("%s\n", out_lines.items[j]);
+        }
+        if (out) {
+            fprintf(out, "# %s\n", job->url);
+            for (size_t j = 0; j < out_lines.count; j++) {
+                fputs(out_lines.items[j], out);
+                fputc('\n', out);
+            }
+        }
+        stats_phase_end(rs, PHASE_OUTPUT);
+        sl_free(&out_lines);
+    }
+
+    curl_multi_remove_handle(multi, job->easy);
+    curl_easy_cleanup(job->easy);
+    curl_slist_free_all(job->resolve);
+    header_urls_free(&job->hdr);
+    kno_free(job->body.data);
+    kno_free(job->url);
+    kno_free(job);
+}
+
+/* Park a transiently failed transfer until delay_ms from now. Returns 0 if it could not be parked. */
+static int batch_defer(CURLM *multi, BatchJob *job, CURLcode res, double delay_ms, RetryHeap *heap, long max_retries) {
+    char why[CURL_ERROR_SIZE];
+    if (!retry_heap_push(heap, mono_ms() + delay_ms, job)) return 0;
+    job->attempts++;
+    retry_reason(job->easy, res, job->errbuf, why, sizeof(why));
+    fprintf(stderr, "[!] %s: %s; retry %d of %ld in %.1f s\n", job->url, why, job->attempts, max_retries,
+            delay_ms / 1000.0);
+    METRIC_ADD(retries, 1);
+    curl_multi_remove_handle(multi, job->easy);
+    kno_free(job->body.data);
+    job->body.data = NULL;
+    job->body.size = 0;
+    header_urls_reset(&job->hdr);
+    job->errbuf[0] = '\0';
+    return 1;
+}
+
+/* Put a parked transfer back on the multi handle; its easy handle keeps every option. */
+static void batch_restart(CURLM *multi, BatchJob *job) {
+    fetch_collect_headers(job->easy, &job->hdr);
+    job->started_ms = mono_ms();
+    curl_multi_add_handle(multi, job->easy);
+}
+
+/* Returns 0 once every target has been attempted, 1 if the batch could not start. */
+static int run_batch_mode(char **args, int argc) {
+    HtmlOptions o;
+    RunStats rs;
+    MetricsServer metrics;
+    StrList targets; sl_init(&targets);
+    DnsTable dns;
+    RetryPolicy retry;
+    RetryHeap parked;
+    FILE *out = NULL;
+
+    memset(&dns, 0, sizeof(dns));
+    memset(&parked, 0, sizeof(parked));
+    if (!html_options_parse(&o, args, argc)) return 1;
+    retry_policy_init(&retry, o.retries, o.retry_budget);
+    if (o.full_mode || o.probe) {
+        printf("Error: --full and --probe cannot be combined with --batch.\n");
+        html_options_free(&o);
+        return 1;
+    }
+    if (!batch_load_targets(o.batch_file, &targets)) {
+        html_options_free(&o);
+        return 1;
+    }
+    if (targets.count == 0) {
+        printf("[-] No targets in %s\n", o.batch_file);
+        html_options_free(&o);
+        return 1;
+    }
+    if (o.output_file) {
+        out = fopen(o.output_file, "w");
+        if (!out) fprintf(stderr, "[-] Failed to write to %s\n", o.output_file);
+    }
+
+    CURLM *multi = net_init() ? curl_multi_init() : NULL;
+    if (!multi) {
+        fprintf(stderr, "[-] Failed to init CURL multi handle\n");
+        if (out) fclose(out);
+        sl_free(&targets);
+        html_options_free(&o);
+        return 1;
+    }
+
+    fetch_setup_multi(multi, o.host_conns, o.h2_streams);
+
+    memset(&rs, 0, sizeof(rs));
+    rs.enabled = o.stats;
+    tls_counts_reset();
+    rs.hw = rs.enabled && hw_open();
+    if (rs.enabled) mem_reset();
+    rs.trace = o.trace_file != NULL;
+    if (rs.trace) trace_begin();
+    lat_reset();
+    metrics_reset();
+    METRIC_SET(pending, targets.count);
+    metrics.fd = -1;
+    if (o.metrics_addr && !metrics_start(&metrics, o.metrics_addr)) {
+        curl_multi_cleanup(multi);
+        if (out) fclose(out);
+        sl_free(&targets);
+        html_options_free(&o);
+        return 1;
+    }
+
+    printf("[*] Batch: %zu targets from %s, concurrency %ld\n", targets.count, o.batch_file, o.concurrency);
+    if (!o.no_prewarm) dns_prewarm(&targets, o.dns_ttl, &dns);
+    double started = mono_ms();
+    double next_report = started + (double)o.report_interval * 1000.0;
+    size_t next = 0, in_flight = 0, done = 0;
+
+    while (next < targets.count || in_flight > 0 || parked.count > 0) {
+        /* Due retries go first: their targets have waited longest. */
+        BatchJob *due;
+        while (in_flight < (size_t)o.concurrency && (due = (BatchJob *)retry_heap_pop_due(&parked, mono_ms())) != NULL) {
+            batch_restart(multi, due);
+            in_flight++;
+        }
+        while (in_flight < (size_t)o.concurrency && next < targets.count) {
+            BatchJob *job = (BatchJob *)kno_malloc(sizeof(BatchJob));
+            if (job && batch_start(multi, job, targets.items[next], &dns, &o)) {
+                retry_earn(&retry);
+                in_flight++;
+            } else {
+                kno_free(job);
+                fprintf(stderr, "[-] Failed to start transfer for %s\n", targets.items[next]);
+                done++;
+            }
+            next++;
+        }
+        METRIC_SET(in_flight, in_flight);
+        METRIC_SET(pending, targets.count - next);
+        METRIC_SET(retrying, parked.count);
+
+        int running = 0;
+        mem_phase(MEM_FETCH);
+        if (rs.hw) hw_begin();
+        curl_multi_perform(multi, &running);
+        if (rs.hw) hw_end(&rs.hw_phase[HW_SLOT_FETCH]);
+        mem_phase(MEM_OTHER);
+
+        CURLMsg *msg;
+        int left;
+        while ((msg = curl_multi_info_read(multi, &left)) != NULL) {
+            if (msg->msg != CURLMSG_DONE) continue;
+            BatchJob *job = NULL;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **)&job);
+            CURLcode res = msg->data.result;
+            double delay = retry_plan(&retry, job->easy, res, job->attempts + 1);
+            if (delay >= 0.0 && batch_defer(multi, job, res, delay, &parked, o.retries)) {
+                in_flight--;
+                continue;
+            }
+            batch_finish(multi, job, res, &o, &rs, out);
+            METRIC_ADD(completed, 1);
+            in_flight--;
+            done++;
+        }
+        METRIC_SET(in_flight, in_flight);
+
+        if (o.report_interval > 0 && mono_ms() >= next_report) {
+            printf("[*] progress: %zu/%zu done, %zu in flight, %zu waiting to retry, %.1f s elapsed\n",
+                   done, targets.count, in_flight, parked.count, (mono_ms() - started) / 1000.0);
+            lat_report(0);
+            next_report = mono_ms() + (double)o.report_interval * 1000.0;
+        }
+
+        if (in_flight > 0 || parked.count > 0) {
+            if (rs.hw) hw_begin();
+            curl_multi_poll(multi, NULL, 0, retry_heap_wait_ms(&parked, 100), NULL);
+            if (rs.hw) hw_end(&rs.hw_phase[HW_SLOT_FETCH]);
+        }
+    }
+
+    printf("[*] Batch complete: %zu targets in %.2f s\n", targets.count, (mono_ms() - started) / 1000.0);
+    if (retry.scheduled + retry.denied > 0) {
+        printf("[*] Retries: %zu scheduled, %zu refused by the retry budget\n", retry.scheduled, retry.denied);
+    }
+    lat_report(1);
+    if (rs.enabled) {
+        rs.run_wall_ms = mono_ms() - started;
+        stats_print(&rs);
+    }
+    if (out) {
+        fclose(out);
+        printf("[*] Results written to %s\n", o.output_file);
+    }
+    if (rs.trace) trace_write(o.trace_file);
+    metrics_stop(&metrics);
+
+    curl_multi_cleanup(multi);
+    retry_heap_free(&parked);
+    dns_table_free(&dns);
+    sl_free(&targets);
+    html_options_free(&o);
+    return 0;
+}
+
+/* ---------- Daemon mode (--serve <socket>) ---------- */
+/*
+ * Clients connect to a Unix socket and send one request line in REPL syntax
+ * ("https://x -s --search cdn"). The listing is written back on the same
+ * connection, ending with a "[*] done" line, and the connection is closed.
+ * One engine thread owns a curl multi handle (keep-alive pool) and a share
+ * handle (DNS cache, TLS sessions) used by every request, so they stay warm
+ * between clients.
+ * The accepting thread polls new connections and collects each request
+ * line without blocking, so a slow client holds no worker. A worker pool
+ * compiles the options of complete requests and renders finished pages.
+ */
+#ifndef _WIN32
+#define SERVE_MAX_WORKERS 64
+#define SERVE_MAX_READING 256   /* connections still sending their request line */
+#define SERVE_READ_MS 2000.0    /* budget for the whole request line */
+
+enum { SERVE_PARSE, SERVE_RENDER };
+
+typedef struct ServeJob {
+    int state;
+    int fd;
+    char line[MAX_LINE];
+    size_t have;            /* bytes of line received so far */
+    double deadline_ms;     /* the request line must be complete by then */
+    char *url;
+    HtmlOptions opts;
+    int have_opts;
+    CURL *easy;
+    struct MemoryBuffer body;
+    HeaderUrls hdr;
+    CURLcode result;
+    double started_ms;
+    int attempts;           /* retries so far */
+    char errbuf[CURL_ERROR_SIZE];
+    struct ServeJob *next;
+    struct ServeJob *active_prev;   /* engine-owned list of running transfers */
+    struct ServeJob *active_next;
+} ServeJob;
+
+typedef struct {
+    ServeJob *head;
+    ServeJob *tail;
+} ServeQueue;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    ServeQueue work;        /* new connections and finished transfers */
+    ServeQueue pending;     /* transfers waiting for the engine */
+    CURLM *multi;
+    CURLSH *share;
+    pthread_mutex_t share_locks[CURL_LOCK_DATA_LAST];
+    ServeJob *active;
+    RetryPolicy retry;      /* engine thread only */
+    RetryHeap parked;
+    atomic_int stop;
+    atomic_size_t served;
+} ServeEngine;
+
+/* Easy handles are cleaned up on worker threads, so the share needs locks. */
+static void serve_share_lock(CURL *h, curl_lock_data data, curl_lock_access access, void *userp) {
+    (void)h;
+    (void)access;
+    pthread_mutex_lock(&((ServeEngine *)userp)->share_locks[data]);
+}
+
+static void serve_share_unlock(CURL *h, curl_lock_data data, void *userp) {
+    (void)h;
+    pthread_mutex_unlock(&((ServeEngine *)userp)->share_locks[data]);
+}
+
+static volatile sig_atomic_t g_serve_signal = 0;
+
+static void serve_on_signal(int sig) {
+    (void)sig;
+    g_serve_signal = 1;
+}
+
+static void serve_queue_push(ServeQueue *q, ServeJob *j) {
+    j->next = NULL;
+    if (q->tail) q->tail->next = j;
+    else q->head = j;
+    q->tail = j;
+}
+
+static ServeJob *serve_queue_pop(ServeQueue *q) {
+    ServeJob *j = q->head;
+    if (j) {
+        q->head = j->next;
+        if (!q->head) q->tail = NULL;
+    }
+    return j;
+}
+
+static void serve_push_work(ServeEngine *e, ServeJob *j) {
+    pthread_mutex_lock(&e->lock);
+    serve_queue_push(&e->work, j);
+    pthread_cond_signal(&e->ready);
+    pthread_mutex_unlock(&e->lock);
+}
+
+static void serve_job_free(ServeJob *j) {
+    if (j->fd >= 0) close(j->fd);
+    if (j->easy) curl_easy_cleanup(j->easy);
+    if (j->have_opts) html_options_free(&j->opts);
+    header_urls_free(&j->hdr);
+    kno_free(j->body.data);
+    kno_free(j->url);
+    kno_free(j);
+}
+
+/* Take what the client has sent so far: 1 = request line complete, 0 = not yet, -1 = drop it. */
+static int serve_read_some(ServeJob *j) {
+    ssize_t r = recv(j->fd, j->line + j->have, sizeof(j->line) - 1 - j->have, MSG_DONTWAIT);
+    if (r < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ? 0 : -1;
+    if (r == 0) return j->have > 0 ? 1 : -1;   /* closed: an unterminated line still counts */
+    j->have += (size_t)r;
+    j->line[j->have] = '\0';
+    char *nl = strchr(j->line, '\n');
+    if (nl) {
+        *nl = '\0';
+        if (nl > j->line && nl[-1] == '\r') nl[-1] = '\0';
+        return 1;
+    }
+    return j->have + 1 < sizeof(j->line) ? 0 : 1;
+}
+
+/* Parse and validate a request, then hand its transfer to the engine. */
+static void serve_intake(ServeEngine *e, ServeJob *j) {
+    static const char *allowed[] = {
+        "-s","-md","-a","-d","-ht","-O","--no-media","--search","--filter","--full",
+        "--no-header-urls","--max-redirs"
+    };
+    char *tokens[64];
+    int ntok, arg_start = 0;
+
+    ntok = split_tokens(j->line, tokens, 64);
+    j->url = command_url(tokens, ntok, &arg_start);
+    if (!j->url) {
+        dprintf(j->fd, "[-] No URL detected.\n");
+        serve_job_free(j);
+        return;
+    }
+    for (int i = arg_start; i < ntok; i++) {
+        if (tokens[i][0] != '-') continue;
+        int known = 0;
+        for (size_t k = 0; k < sizeof(allowed) / sizeof(allowed[0]); k++) {
+            if (strcmp(tokens[i], allowed[k]) == 0) known = 1;
+        }
+        if (!known) {
+            dprintf(j->fd, "Error: %s is not available over --serve\n", tokens[i]);
+            serve_job_free(j);
+            return;
+        }
+    }
+    if (!html_options_parse(&j->opts, tokens + arg_start, ntok - arg_start)) {
+        dprintf(j->fd, "Error: invalid request flags.\n");
+        serve_job_free(j);
+        return;
+    }
+    j->have_opts = 1;
+
+    j->easy = curl_easy_init();
+    if (!j->easy) {
+        dprintf(j->fd, "[-] Failed to init CURL\n");
+        serve_job_free(j);
+        return;
+    }
+    fetch_setup_easy(j->easy, j->url, &j->body, &j->opts.limits);
+    fetch_setup_multiplexed(j->easy);
+    j->hdr.header_urls = !j->opts.no_header_urls;
+    j->hdr.max_redirs = j->opts.max_redirs;
+    fetch_collect_headers(j->easy, &j->hdr);
+    curl_easy_setopt(j->easy, CURLOPT_ERRORBUFFER, j->errbuf);
+    curl_easy_setopt(j->easy, CURLOPT_PRIVATE, (void *)j);
+    if (e->share) curl_easy_setopt(j->easy, CURLOPT_SHARE, e->share);
+    j->started_ms = mono_ms();
+    j->state = SERVE_RENDER;
+
+    pthread_mutex_lock(&e->lock);
+    serve_queue_push(&e->pending, j);
+    pthread_mutex_unlock(&e->lock);
+    curl_multi_wakeup(e->multi);
+}
+
+static void serve_render(ServeEngine *e, ServeJob *j) {
+    FILE *out = fdopen(j->fd, "w");
+    long status = 0;
+    if (!out) {
+        serve_job_free(j);
+        return;
+    }
+    j->fd = -1;     /* owned by out now */
+    curl_easy_getinfo(j->easy, CURLINFO_RESPONSE_CODE, &status);
+
+    if (j->result != CURLE_OK) {
+        fprintf(out, "[-] CURL error fetching %s: %s\n", j->url,
+                j->errbuf[0] ? j->errbuf : curl_easy_strerror(j->result));
+    } else if (j->opts.full_mode) {
+        fputs(j->body.data ? j->body.data : "", out);
+        fputc('\n', out);
+    } else {
+        RunStats rs;
+        StrList lines; sl_init(&lines);
+        memset(&rs, 0, sizeof(rs));
+        render_page(j->body.data ? j->body.data : "", j->body.size, &j->opts, &rs, &j->hdr, &lines);
+        for (size_t i = 0; i < lines.count; i++) {
+            fputs(lines.items[i], out);
+            fputc('\n', out);
+        }
+        if (lines.count == 0) fputs("[*] No URLs matched filters.\n", out);
+        sl_free(&lines);
+    }
+    fprintf(out, "[*] done: %s (HTTP %ld, %zu bytes, %.1f ms)\n", j->url, status, j->body.size,
+            mono_ms() - j->started_ms);
+    fclose(out);
+    atomic_fetch_add(&e->served, 1);
+    serve_job_free(j);
+}
+
+static void *serve_worker(void *arg) {
+    ServeEngine *e = (ServeEngine *)arg;
+    for (;;) {
+        pthread_mutex_lock(&e->lock);
+        while (!e->work.head && !atomic_load(&e->stop)) pthread_cond_wait(&e->ready, &e->lock);
+        ServeJob *j = serve_queue_pop(&e->work);
+        pthread_mutex_unlock(&e->lock);
+        if (!j) return NULL;
+        if (j->state == SERVE_PARSE) serve_intake(e, j);
+        else serve_render(e, j);
+    }
+}
+
+static void serve_activate(ServeEngine *e, ServeJob *j) {
+    curl_multi_add_handle(e->multi, j->easy);
+    j->active_prev = NULL;
+    j->active_next = e->active;
+    if (e->active) e->active->active_prev = j;
+    e->active = j;
+}
+
+/* Park a transiently failed transfer on the engine's retry heap and tell the client. */
+static int serve_defer(ServeEngine *e, ServeJob *j, double delay_ms) {
+    char why[CURL_ERROR_SIZE];
+    if (!retry_heap_push(&e->parked, mono_ms() + delay_ms, j)) return 0;
+    j->attempts++;
+    retry_reason(j->easy, j->result, j->errbuf, why, sizeof(why));
+    dprintf(j->fd, "[!] %s; retry %d of %ld in %.1f s\n", why, j->attempts, e->retry.max_retries, delay_ms / 1000.0);
+    kno_free(j->body.data);
+    j->body.data = NULL;
+    j->body.size = 0;
+    header_urls_reset(&j->hdr);
+    j->errbuf[0] = '\0';
+    return 1;
+}
+
+static void *serve_engine(void *arg) {
+    ServeEngine *e = (ServeEngine *)arg;
+    while (!atomic_load(&e->stop)) {
+        ServeJob *j;
+        pthread_mutex_lock(&e->lock);
+        while ((j = serve_queue_pop(&e->pending)) != NULL) {
+            retry_earn(&e->retry);
+            serve_activate(e, j);
+        }
+        pthread_mutex_unlock(&e->lock);
+        while ((j = (ServeJob *)retry_heap_pop_due(&e->parked, mono_ms())) != NULL) {
+            fetch_collect_headers(j->easy, &j->hdr);
+            serve_activate(e, j);
+        }
+
+        int running = 0;
+        mem_phase(MEM_FETCH);
+        curl_multi_perform(e->multi, &running);
+        mem_phase(MEM_OTHER);
+
+        CURLMsg *msg;
+        int left;
+        while ((msg = curl_multi_info_read(e->multi, &left)) != NULL) {
+            if (msg->msg != CURLMSG_DONE) continue;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **)&j);
+            j->result = msg->data.result;
+            curl_multi_remove_handle(e->multi, j->easy);
+            if (j->active_prev) j->active_prev->active_next = j->active_next;
+            else e->active = j->active_next;
+            if (j->active_next) j->active_next->active_prev = j->active_prev;
+            double delay = retry_plan(&e->retry, j->easy, j->result, j->attempts + 1);
+            if (delay >= 0.0 && serve_defer(e, j, delay)) continue;
+            serve_push_work(e, j);
+        }
+        curl_multi_poll(e->multi, NULL, 0, retry_heap_wait_ms(&e->parked, 1000), NULL);
+    }
+
+    /* Stopped: drop transfers that are still running. */
+    while (e->active) {
+        ServeJob *j = e->active;
+        e->active = j->active_next;
+        curl_multi_remove_handle(e->multi, j->easy);
+        serve_job_free(j);
+    }
+    for (size_t i = 0; i < e->parked.count; i++) serve_job_free((ServeJob *)e->parked.items[i].job);
+    retry_heap_free(&e->parked);
+    return NULL;
+}
+
+/* --serve <socket> [--workers N]: runs until SIGINT / SIGTERM. */
+static int run_serve_mode(char **args, int argc) {
+    const char *path = NULL;
+    long workers = 4;
+    struct sockaddr_un sun;
+    struct stat st;
+    ServeEngine e;
+    pthread_t engine, pool[SERVE_MAX_WORKERS];
+    long started = 0;
+
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(args[i], "--serve") == 0 && i + 1 < argc) {
+            path = args[++i];
+        } else if (strcmp(args[i], "--workers") == 0 && i + 1 < argc) {
+            workers = atol(args[++i]);
+        } else {
+            printf("Error: --serve only takes --workers N.\n");
+            return 1;
+        }
+    }
+    if (!path || strlen(path) >= sizeof(sun.sun_path)) {
+        printf("Error: --serve requires a socket path.\n");
+        return 1;
+    }
+    if (workers < 1 || workers > SERVE_MAX_WORKERS) {
+        printf("Error: --workers must be between 1 and %d.\n", SERVE_MAX_WORKERS);
+        return 1;
+    }
+
+    memset(&sun, 0, sizeof(sun));
+    sun.sun_family = AF_UNIX;
+    strcpy(sun.sun_path, path);
+    if (stat(path, &st) == 0 && S_ISSOCK(st.st_mode)) unlink(path);
+    int lfd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (lfd < 0 || bind(lfd, (struct sockaddr *)&sun, sizeof(sun)) != 0 || listen(lfd, 128) != 0) {
+        fprintf(stderr, "[-] Could not listen on %s\n", path);
+        if (lfd >= 0) close(lfd);
+        return 1;
+    }
+
+    memset(&e, 0, sizeof(e));
+    pthread_mutex_init(&e.lock, NULL);
+    pthread_cond_init(&e.ready, NULL);
+    e.multi = net_init() ? curl_multi_init() : NULL;
+    if (!e.multi) {
+        fprintf(stderr, "[-] Failed to init CURL multi handle\n");
+        close(lfd);
+        unlink(path);
+        return 1;
+    }
+    fetch_setup_multi(e.multi, 8L, 100L);
+    retry_policy_init(&e.retry, RETRY_DEFAULT, RETRY_DEFAULT_RATIO);
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) pthread_mutex_init(&e.share_locks[i], NULL);
+    e.share = curl_share_init();
+    if (e.share) {
+        curl_share_setopt(e.share, CURLSHOPT_LOCKFUNC, serve_share_lock);
+        curl_share_setopt(e.share, CURLSHOPT_UNLOCKFUNC, serve_share_unlock);
+        curl_share_setopt(e.share, CURLSHOPT_USERDATA, (void *)&e);
+        curl_share_setopt(e.share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(e.share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    }
+
+    void (*old_int)(int) = signal(SIGINT, serve_on_signal);
+    void (*old_term)(int) = signal(SIGTERM, serve_on_signal);
+    void (*old_pipe)(int) = signal(SIGPIPE, SIG_IGN);
+    g_serve_signal = 0;
+
+    pthread_create(&engine, NULL, serve_engine, &e);
+    for (; started < workers; started++) {
+        if (pthread_create(&pool[started], NULL, serve_worker, &e) != 0) break;
+    }
+    printf("[*] Serving on unix:%s with %ld workers (Ctrl-C to stop)\n", path, started);
+    fflush(stdout);
+
+    /* Connections whose request line is still arriving; workers only get complete ones. */
+    ServeJob *reading[SERVE_MAX_READING];
+    size_t nreading = 0;
+    while (!g_serve_signal) {
+        struct pollfd fds[SERVE_MAX_READING + 1];
+        size_t nfds = nreading;
+        double now = mono_ms();
+        int wait = 500;
+        for (size_t i = 0; i < nreading; i++) {
+            int left = (int)(reading[i]->deadline_ms - now);
+            if (left < wait) wait = left > 0 ? left : 0;
+            fds[i].fd = reading[i]->fd;
+            fds[i].events = POLLIN;
+            fds[i].revents = 0;
+        }
+        /* With every read slot taken, new clients wait in the listen backlog. */
+        fds[nfds].fd = nreading < SERVE_MAX_READING ? lfd : -1;
+        fds[nfds].events = POLLIN;
+        fds[nfds].revents = 0;
+        if (poll(fds, nfds + 1, wait) < 0) continue;
+
+        now = mono_ms();
+        for (size_t i = nreading; i-- > 0;) {
+            ServeJob *j = reading[i];
+            int got = fds[i].revents ? serve_read_some(j) : 0;
+            if (got == 0 && now < j->deadline_ms) continue;
+            reading[i] = reading[--nreading];
+            if (got == 1) serve_push_work(&e, j);
+            else serve_job_free(j);
+        }
+        if (!(fds[nfds].revents & POLLIN)) continue;
+        int cfd = accept(lfd, NULL, NULL);
+        if (cfd < 0) continue;
+        ServeJob *j = (ServeJob *)kno_calloc(1, sizeof(ServeJob));
+        if (!j) {
+            close(cfd);
+            continue;
+        }
+        j->fd = cfd;
+        j->state = SERVE_PARSE;
+        j->deadline_ms = mono_ms() + SERVE_READ_MS;
+        reading[nreading++] = j;
+    }
+    while (nreading > 0) serve_job_free(reading[--nreading]);
+
+    atomic_store(&e.stop, 1);
+    pthread_mutex_lock(&e.lock);
+    pthread_cond_broadcast(&e.ready);
+    pthread_mutex_unlock(&e.lock);
+    curl_multi_wakeup(e.multi);
+    pthread_join(engine, NULL);
+    for (long i = 0; i < started; i++) pthread_join(pool[i], NULL);
+
+    /* Requests still queued or in flight when we were stopped. */
+    ServeJob *j;
+    while ((j = serve_queue_pop(&e.work)) != NULL) serve_job_free(j);
+    while ((j = serve_queue_pop(&e.pending)) != NULL) serve_job_free(j);
+
+    curl_multi_cleanup(e.multi);
+    if (e.share) curl_share_cleanup(e.share);
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) pthread_mutex_destroy(&e.share_locks[i]);
+    pthread_cond_destroy(&e.ready);
+    pthread_mutex_destroy(&e.lock);
+    close(lfd);
+    unlink(path);
+    signal(SIGINT, old_int);
+    signal(SIGTERM, old_term);
+    signal(SIGPIPE, old_pipe);
+    printf("\n[*] Server stopped after %zu requests\n", atomic_load(&e.served));
+    return 0;
+}
+#else
+static int run_serve_mode(char **args, int argc) {
+    (void)args;
+    (void)argc;
+    printf("Error: --serve is not supported on Windows.\n");
+    return 1;
+}
+#endif
+
+/* ---------- Command dispatch (one REPL line, or argv in one-shot mode) ---------- */
+enum { CMD_OK, CMD_FAILED, CMD_EXIT };
+
+static void print_help(void) {
+    printf("Kusanagi Night Ops: URL Scrapper (C Edition)\n");
+    printf("HTML mode flags:\n");
+    printf("  -s -md -a -d -ht -O    category filters\n");
+    printf("  --no-media             treat selected as exclusions\n");
+    printf("  --search term1,term2   substring filter\n");
+    printf("  --filter 'expr'        boolean filter, e.g. 'cdn|static & !thumb & cat:media & host:*.example.com'\n");
+    printf("  --full                 dump full HTML\n");
+    printf("  -o file                write output to file\n");
+    printf("  --stats                fetch timings, per-phase wall/CPU time and throughput\n");
+    printf("  --trace out.json       Chrome trace-event spans of fetch/parse phases (Perfetto)\n");
+    printf("  --input file.html      parse a saved page instead of fetching (\"-\" = stdin)\n");
+    printf("  --no-header-urls       skip URLs from Location/Link/CSP/Refresh/ACAO response headers\n");
+    printf("  --max-redirs N         redirects to follow (default 10, 0 = none); hops are listed with --stats\n");
+    printf("  --retries N            retries of a timeout, reset, 429 or 502-504 (default 3, 0 = none)\n");
+    printf("  --retry-budget 0.1     retries allowed per first request, so an outage is not amplified\n");
+    printf("  --connect-timeout 10s  give up on a connection not set up in time (default 10s, 0 = none)\n");
+    printf("  --timeout 2m           give up on a transfer not done in time (default 2m, 0 = none)\n");
+    printf("  --sitemap              list the site's sitemap URLs (robots.txt, sitemap indexes, .xml.gz)\n");
+    printf("  --probe                HEAD each listed URL on the target's host; adds status, size and type\n");
+    printf("  --probe-concurrency N  probes in flight (default 64; --host-conns caps connections, default 6)\n");
+    printf("Batch mode:\n");
+    printf("  --batch file           fetch every URL in file (one per line) instead of a single URL\n");
+    printf("  --concurrency N        transfers in flight (default 8)\n");
+    printf("  --host-conns N         connections per host (default 0 = unlimited)\n");
+    printf("  --h2-streams N         concurrent HTTP/2 streams per connection (default 100)\n");
+    printf("  --no-prewarm           skip resolving every target host before the batch starts\n");
+    printf("  --dns-ttl 5m           lifetime of entries in .kno-url/dns-cache (default 5m, 0 = no cache)\n");
+    printf("  --report-every 10s     interval for progress + latency percentiles (0 = end only)\n");
+    printf("  --metrics ADDR         live Prometheus counters on /path.sock or 127.0.0.1:PORT\n");
+    printf("Daemon mode:\n");
+    printf("  --serve /path.sock     answer request lines (REPL syntax) from local clients until Ctrl-C\n");
+    printf("  --workers N            request/render threads (default 4)\n");
+    printf("Startup:\n");
+    printf("  --rules file           custom category rules (ext/path/host => NAME)\n");
+    printf("  --hosts-map file       pin hostnames to addresses (host:port:addr or 'addr host...')\n");
+    printf("  kno-url [--rules file] [--hosts-map file] <url> flags...   run one command from argv and exit\n");
+    printf("Network mode:\n");
+    printf("  -n                     Network mode not supported in this version (with noise warning)\n");
+    printf("Night Ops:\n");
+    printf("  --night-ops            cleanup & self-destruct\n");
+    printf("  --night-ops -sd 90s    schedule self-destruct\n");
+}
+
+static int run_command(char **tokens, int ntok) {
+    /* Help */
+    if (ntok == 1 && (strcmp(tokens[0], "-h") == 0 || strcmp(tokens[0], "--help") == 0)) {
+        print_help();
+        return CMD_OK;
+    }
+
+    /* Standalone --night-ops (no URL, no other tokens) */
+    if (ntok == 1 && strcmp(tokens[0], "--night-ops") == 0) {
+        char ans[16];
+        printf("[!] --night-ops will attempt to delete this binary and local .kno-url dir. Proceed? [y/N]: ");
+        if (!fgets(ans, sizeof(ans), stdin)) {
+            printf("\n[*] --night-ops canceled.\n");
+            return CMD_OK;
+        }
+        if (ans[0] == 'y' || ans[0] == 'Y') {
+            night_ops_cleanup();
+            return CMD_EXIT;
+        } else {
+            printf("[*] --night-ops canceled; no cleanup performed.\n");
+            return CMD_OK;
+        }
+    }
+
+    /* URL parsing (--batch and --input lines take their pages from files instead) */
+    char *url = NULL;
+    int arg_start = 0;
+    int batch = 0;
+    int offline = 0;
+
+    for (int i = 0; i < ntok; i++) {
+        if (strcmp(tokens[i], "--batch") == 0) batch = 1;
+        if (strcmp(tokens[i], "--input") == 0) offline = 1;
+        if (strcmp(tokens[i], "--serve") == 0) return run_serve_mode(tokens, ntok) ? CMD_FAILED : CMD_OK;
+    }
+
+    if (!batch && !offline) url = command_url(tokens, ntok, &arg_start);
+
+    char *args[64];
+    int aargc = 0;
+    for (int i = arg_start; i < ntok && aargc < 64; i++) {
+        args[aargc++] = tokens[i];
+    }
+
+    if (!url && !batch && !offline) {
+        printf("[-] No URL detected. Use -h or --help for usage, or use '--night-ops' alone.\n");
+        return CMD_FAILED;
+    }
+
+    /* Parse Night Ops & -sd duration */
+    int night_ops = 0;
+    long sd_seconds = -1;
+
+    for (int i = 0; i < aargc; i++) {
+        if (strcmp(args[i], "--night-ops") == 0) night_ops = 1;
+    }
+
+    for (int i = 0; i < aargc; i++) {
+        if (strcmp(args[i], "-sd") == 0) {
+            char durbuf[128];
+            durbuf[0] = '\0';
+            int j = i + 1;
+            int first = 1;
+            while (j < aargc && args[j][0] != '-') {
+                if (!first) strncat(durbuf, " ", sizeof(durbuf) - strlen(durbuf) - 1);
+                strncat(durbuf, args[j], sizeof(durbuf) - strlen(durbuf) - 1);
+                first = 0;
+                j++;
+            }
+            if (durbuf[0] == '\0') {
+                printf("Error: -sd requires a duration like '90s' or '1h30m'.\n");
+                kno_free(url);
+                return CMD_FAILED;
+            }
+            sd_seconds = parse_duration_seconds(durbuf);
+            if (sd_seconds <= 0) {
+                printf("Error: invalid -sd duration: %s\n", durbuf);
+                kno_free(url);
+                return CMD_FAILED;
+            }
+            int new_aargc = 0;
+            for (int k = 0; k < aargc; k++) {
+                if (k == i) {
+                    k = j - 1;
+                    continue;
+                }
+                args[new_aargc++] = args[k];
+            }
+            aargc = new_aargc;
+            break;
+        }
+    }
+
+    if (sd_seconds >= 0 && !night_ops) {
+        printf("Error: -sd can only be used together with --night-ops.\n");
+        kno_free(url);
+        return CMD_FAILED;
+    }
+
+    if (night_ops && sd_seconds < 0) {
+        printf("Error: --night-ops can't be ran along side other commands unless -sd is defined with a time to execute\n");
+        kno_free(url);
+        return CMD_FAILED;
+    }
+
+    if (night_ops) {
+        int new_aargc = 0;
+        for (int i = 0; i < aargc; i++) {
+            if (strcmp(args[i], "--night-ops") == 0) continue;
+            args[new_aargc++] = args[i];
+        }
+        aargc = new_aargc;
+    }
+
+    /* Network mode stub with red-team warning */
+    int net_mode = 0;
+    for (int i = 0; i < aargc; i++) {
+        if (strcmp(args[i], "-n") == 0) {
+            net_mode = 1;
+            break;
+        }
+    }
+    if (net_mode) {
+        char ans[16];
+        printf("WARNING: Network mode may be noisy for a stealthy Red Team Op, would you like to proceed? [y/N]: ");
+        if (!fgets(ans, sizeof(ans), stdin)) {
+            printf("\n[*] Network mode canceled.\n");
+        } else {
+            if (ans[0] == 'y' || ans[0] == 'Y') {
+                printf("Network mode not supported in this version\n");
+            } else {
+                printf("[*] Network mode canceled.\n");
+            }
+        }
+        kno_free(url);
+        return CMD_OK;
+    }
+
+    /* Unknown flags detection */
+    const char *valid_flags[] = {
+        "-s","-md","-a","-d","-ht","-O",
+        "--no-media","--search","--filter","--full","--stats",
+        "--trace","--input","--metrics","--batch","--concurrency","--report-every",
+        "--host-conns","--h2-streams","--no-prewarm","--dns-ttl","--sitemap",
+        "--no-header-urls","--max-redirs","--probe","--probe-concurrency",
+        "--retries","--retry-budget","--connect-timeout","--timeout",
+        "-o","-u","-h","--help"
+    };
+    int nvalid = (int)(sizeof(valid_flags)/sizeof(valid_flags[0]));
+    int bad = 0;
+    for (int i = 0; i < aargc; i++) {
+        if (args[i][0] != '-' || args[i][1] == '\0') continue;   /* "-" is stdin, not a flag */
+        int known = 0;
+        for (int j = 0; j < nvalid; j++) {
+            if (strcmp(args[i], valid_flags[j]) == 0) {
+                known = 1;
+                break;
+            }
+        }
+        if (!known) {
+            printf("Error: That flag does not exist: %s\n", args[i]);
+            bad = 1;
+            break;
+        }
+    }
+    if (bad) {
+        kno_free(url);
+        return CMD_FAILED;
+    }
+
+    int sitemap = 0;
+    for (int i = 0; i < aargc; i++) {
+        if (strcmp(args[i], "--sitemap") == 0) sitemap = 1;
+    }
+    if (sitemap && !url) {
+        printf("Error: --sitemap needs a site URL and cannot be combined with --batch or --input.\n");
+        kno_free(url);
+        return CMD_FAILED;
+    }
+
+    int rc = batch ? run_batch_mode(args, aargc)
+           : sitemap ? run_sitemap_mode(url, args, aargc)
+           : run_html_mode(url, args, aargc);
+
+    if (night_ops && sd_seconds > 0) {
+        printf("[*] --night-ops scheduled via -sd, sleeping for %ld seconds before cleanup...\n", sd_seconds);
+#ifdef _WIN32
+        Sleep((DWORD)(sd_seconds * 1000));
+#else
+        sleep((unsigned int)sd_seconds);
+#endif
+        night_ops_cleanup();
+        kno_free(url);
+        return CMD_EXIT;
+    }
+
+    kno_free(url);
+    return rc ? CMD_FAILED : CMD_OK;
+}
+
+/* ---------- Main loop with Night Ops semantics ---------- */
+/* kno-url-bench.c and libkno-url.c include this file with KNO_URL_NO_MAIN defined. */
+#ifndef KNO_URL_NO_MAIN
+int main(int argc, char **argv) {
+    char line[MAX_LINE];
+    const char *rules_path = NULL;
+    const char *hosts_path = NULL;
+    char *cmd[64];
+    int ncmd = 0;
+
+    if (argc > 0 && argv[0]) {
+        g_exe_path = kno_strdup(argv[0]);
+    }
+
+    /* Anything besides --rules / --hosts-map is a one-shot command: kno-url https://x -s -a -o out */
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--rules") == 0 && i + 1 < argc) {
+            rules_path = argv[++i];
+        } else if (strcmp(argv[i], "--hosts-map") == 0 && i + 1 < argc) {
+            hosts_path = argv[++i];
+        } else if (ncmd < 64) {
+            cmd[ncmd++] = argv[i];
+        } else {
+            fprintf(stderr, "Usage: %s [--rules <file>] [--hosts-map <file>] [<url> flags...]\n", argv[0]);
+            kno_free(g_exe_path);
+            return 1;
+        }
+    }
+
+    if (ncmd > 0) {
+        int rc = category_rules_init(rules_path) && (!hosts_path || hosts_map_load(hosts_path))
+            ? run_command(cmd, ncmd) : CMD_FAILED;
+        fflush(stdout);
+        hosts_map_free();
+        net_cleanup();
+        kno_free(g_exe_path);
+        return rc == CMD_FAILED ? 1 : 0;
+    }
+
+    printf("Kusanagi Night Ops: URL Scrapper (C Edition)\n");
+    if (!category_rules_init(rules_path) || (hosts_path && !hosts_map_load(hosts_path))) {
+        kno_free(g_exe_path);
+        return 1;
+    }
+
+    for (;;) {
+        printf("Main URL: ");
+        fflush(stdout);
+        if (!fgets(line, sizeof(line), stdin)) break;
+
+        size_t len = strlen(line);
+        if (len > 0 && line[len-1] == '\n') line[len-1] = '\0';
+        if (line[0] == '\0') {
+            printf("[-] No URL detected. Use -h or --help for usage.\n");
+            continue;
+        }
+
+        char *tokens[64];
+        int ntok = split_tokens(line, tokens, 64);
+        if (ntok == 0) {
+            printf("[-] No URL detected.\n");
+            continue;
+        }
+
+        if (run_command(tokens, ntok) == CMD_EXIT) {
+            hosts_map_free();
+            net_cleanup();
+            return 0;
+        }
+    }
+
+    hosts_map_free();
+    net_cleanup();
+    kno_free(g_exe_path);
+    return 0;
+}
+#endif /* KNO_URL_NO_MAIN */
@@ -0,0 +1,150 @@
+/*
+ * Kusanagi Night Ops: URL Scrapper (C Edition) - embeddable library API
+ *
+ * libkno-url exposes the scraper's extract / categorize / search / filter /
+ * render pipeline, plus an optional libcurl fetch, to programs that want to
+ * scan pages in-process instead of running kno-url-c per response:
+ *
+ *   cc -O2 -pthread -fPIC -fvisibility=hidden -shared -o libkno-url.so libkno-url.c -lcurl
+ *   cc -O2 -pthread -c libkno-url.c && ar rcs libkno-url.a libkno-url.o
+ *
+ * Conventions:
+ *   - Page buffers are (pointer, length) and need not be NUL-terminated.
+ *   - Results go to callbacks. URL spans passed to a callback point into the
+ *     caller's buffer (or into library-owned storage for kno_render) and are
+ *     only valid during the call. A callback returns 0 to continue or nonzero
+ *     to stop early.
+ *   - kno_init() must be called once before anything else. After it returns,
+ *     every function here is safe to call from several threads at once;
+ *     compiled search and filter objects are read-only and may be shared.
+ *   - Functions returning int use 0 for success and -1 for failure unless
+ *     documented otherwise.
+ *
+ * KNO_API_VERSION changes only when an existing declaration changes.
+ */
+#ifndef KNO_URL_H
+#define KNO_URL_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define KNO_API_VERSION 1
+
+#if defined(_WIN32) && defined(KNO_BUILD_DLL)
+#define KNO_API __declspec(dllexport)
+#elif defined(__GNUC__)
+#define KNO_API __attribute__((visibility("default")))
+#else
+#define KNO_API
+#endif
+
+/* Built-in categories. A rules file passed to kno_init() may add ids >= KNO_CAT_BUILTIN_COUNT. */
+enum {
+    KNO_CAT_SCRIPTS,
+    KNO_CAT_MEDIA,
+    KNO_CAT_API,
+    KNO_CAT_DOCS,
+    KNO_CAT_HTML,
+    KNO_CAT_OTHER,
+    KNO_CAT_BUILTIN_COUNT
+};
+
+/* One URL (or, for kno_render, one output line). Return nonzero to stop. */
+typedef int (*kno_url_cb)(const char *url, size_t len, void *user);
+
+/* A chunk of a response body as it arrives. Return nonzero to abort the transfer. */
+typedef int (*kno_body_cb)(const char *data, size_t len, void *user);
+
+typedef struct kno_search kno_search;
+typedef struct kno_filter kno_filter;
+
+/* Options for kno_render(); zero-initialise for the defaults (every category, no search). */
+typedef struct {
+    unsigned categories;        /* bitmask of 1u << KNO_CAT_*, 0 = all categories */
+    int no_media;               /* drop the selected categories instead (like --no-media) */
+    const kno_search *search;   /* keep URLs matching any term, NULL = keep all */
+    const kno_filter *filter;   /* boolean --filter expression, NULL = none */
+} kno_render_opts;
+
+/* Library version string, e.g. "1.0". */
+KNO_API const char *kno_version(void);
+
+/*
+ * Build the category tables, optionally from a rules file (same format as
+ * --rules; NULL for the built-ins only), and initialise libcurl. Call once,
+ * before any other function and before starting threads that use the
+ * library. Rules-file errors are reported on stderr.
+ */
+KNO_API int kno_init(const char *rules_path);
+
+/* Release libcurl. No other function may be called afterwards. */
+KNO_API void kno_cleanup(void);
+
+/*
+ * Find the URLs in buf (http://, https:// and blob: tokens) and pass each one
+ * to cb as a span of buf. base is the page URL; extraction currently only
+ * reports absolute URLs, so it is accepted for API stability and unused.
+ * Returns the number of URLs passed to cb.
+ */
+KNO_API size_t kno_extract(const char *buf, size_t len, const char *base, kno_url_cb cb, void *user);
+
+/* Category id of one URL (does not need to be NUL-terminated). */
+KNO_API int kno_categorize(const char *url, size_t len);
+
+/* Number of categories, built-in plus rules-file ones. */
+KNO_API int kno_category_count(void);
+
+/* Display name of a category ("SCRIPTS", "API / ENDPOINTS", ...), or NULL if out of range. */
+KNO_API const char *kno_category_name(int cat);
+
+/*
+ * Canonical form of a command-line target (www.x and bare hosts get https://),
+ * as the CLI applies to its argument. Free with kno_string_free().
+ */
+KNO_API char *kno_canonicalize(const char *url);
+
+/* Free a string returned by the library. */
+KNO_API void kno_string_free(char *s);
+
+/* Compile comma-separated --search terms (case-insensitive substrings). NULL on error. */
+KNO_API kno_search *kno_search_compile(const char *terms);
+
+/* 1 if url contains any of the terms, else 0. */
+KNO_API int kno_search_match(const kno_search *s, const char *url, size_t len);
+
+KNO_API void kno_search_free(kno_search *s);
+
+/*
+ * Compile a --filter expression. On error returns NULL and, if err is not
+ * NULL, points *err at a static message.
+ */
+KNO_API kno_filter *kno_filter_compile(const char *expr, const char **err);
+
+/* 1 if url (already categorized as cat) satisfies the expression, else 0. */
+KNO_API int kno_filter_match(const kno_filter *f, const char *url, size_t len, int cat);
+
+KNO_API void kno_filter_free(kno_filter *f);
+
+/*
+ * Extract, filter, categorize and sort one page exactly as the CLI prints it,
+ * passing each output line (category headers, URLs, blank separators) to cb.
+ * opts may be NULL. Returns the number of URLs kept.
+ */
+KNO_API long kno_render(const char *buf, size_t len, const kno_render_opts *opts, kno_url_cb cb, void *user);
+
+/*
+ * Fetch url with the scraper's libcurl settings (up to 10 redirects are
+ * followed), streaming the final response body to cb. *status receives its
+ * HTTP status if status is not NULL. Returns 0 on a
+ * completed transfer (any HTTP status), -1 on a transfer error or abort.
+ */
+KNO_API int kno_fetch(const char *url, kno_body_cb cb, void *user, long *status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* KNO_URL_H */
@@ -0,0 +1,246 @@
+/*
+ * Kusanagi Night Ops: URL Scrapper (C Edition) - libkno-url
+ *
+ * Builds kno-url.c without its main() and wraps the page pipeline in the
+ * stable API declared in kno-url.h:
+ *
+ *   cc -O2 -pthread -fPIC -fvisibility=hidden -shared -o libkno-url.so libkno-url.c -lcurl
+ *   cc -O2 -pthread -c libkno-url.c && ar rcs libkno-url.a libkno-url.o
+ *
+ * Everything from kno-url.c stays static; only the kno_* functions below are
+ * exported.
+ */
+#define KNO_URL_NO_MAIN
+#define KNO_CURL_LINKED
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#pragma GCC diagnostic ignored "-Wunused-variable"
+#endif
+#include "kno-url.c"
+#if defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+#include "kno-url.h"
+
+#if KNO_CAT_BUILTIN_COUNT != CAT_BUILTIN_COUNT
+#error "kno-url.h category ids are out of sync with kno-url.c"
+#endif
+
+struct kno_search {
+    Needle *needles;
+    size_t count;
+};
+
+struct kno_filter {
+    Filter filter;
+};
+
+/* NUL-terminated copy of a span: into buf when it fits, else on the heap (*heap set). */
+static const char *lib_cstr(const char *s, size_t len, char *buf, size_t cap, char **heap) {
+    char *d = buf;
+    *heap = NULL;
+    if (len >= cap) {
+        d = *heap = (char *)kno_malloc(len + 1);
+        if (!d) return NULL;
+    }
+    memcpy(d, s, len);
+    d[len] = '\0';
+    return d;
+}
+
+const char *kno_version(void) {
+    return "1.0";
+}
+
+int kno_init(const char *rules_path) {
+    if (!category_rules_init(rules_path)) return -1;
+#ifdef KNO_HAVE_AVX2
+    (void)cpu_has_avx2();   /* cache the CPU check before threads race on it */
+#endif
+    return net_init() ? 0 : -1;
+}
+
+void kno_cleanup(void) {
+    net_cleanup();
+}
+
+size_t kno_extract(const char *buf, size_t len, const char *base, kno_url_cb cb, void *user) {
+    (void)base;
+    if (!buf || !cb) return 0;
+    return extract_urls_scan(buf, len, cb, user);
+}
+
+int kno_categorize(const char *url, size_t len) {
+    char buf[1024], *heap;
+    const char *u = lib_cstr(url, len, buf, sizeof(buf), &heap);
+    if (!u) return CAT_OTHER;
+    int cat = categorize_url(u);
+    kno_free(heap);
+    return cat;
+}
+
+int kno_category_count(void) {
+    return g_cat_count;
+}
+
+const char *kno_category_name(int cat) {
+    return cat >= 0 && cat < g_cat_count ? g_cat_names[cat] : NULL;
+}
+
+char *kno_canonicalize(const char *url) {
+    return normalize_url(url);
+}
+
+void kno_string_free(char *s) {
+    kno_free(s);
+}
+
+kno_search *kno_search_compile(const char *terms) {
+    StrList list; sl_init(&list);
+    char *copy = terms ? kno_strdup(terms) : NULL;
+    kno_search *s = NULL;
+
+    if (!copy) return NULL;
+    /* Same splitting as --search: comma-separated, leading blanks dropped. */
+    for (char *tok = copy, *comma; tok; tok = comma ? comma + 1 : NULL) {
+        comma = strchr(tok, ',');
+        if (comma) *comma = '\0';
+        while (*tok && isspace((unsigned char)*tok)) tok++;
+        if (*tok) sl_add(&list, tok);
+    }
+    kno_free(copy);
+    if (list.count == 0) goto done;
+
+    s = (kno_search *)kno_calloc(1, sizeof(*s));
+    if (!s) goto done;
+    s->needles = (Needle *)kno_calloc(list.count, sizeof(Needle));
+    if (!s->needles) {
+        kno_free(s);
+        s = NULL;
+        goto done;
+    }
+    for (size_t i = 0; i < list.count; i++) {
+        if (!needle_init(&s->needles[i], list.items[i])) {
+            kno_search_free(s);
+            s = NULL;
+            goto done;
+        }
+        s->count++;
+    }
+done:
+    sl_free(&list);
+    return s;
+}
+
+int kno_search_match(const kno_search *s, const char *url, size_t len) {
+    for (size_t i = 0; i < s->count; i++) {
+        if (needle_match(&s->needles[i], url, len)) return 1;
+    }
+    return 0;
+}
+
+void kno_search_free(kno_search *s) {
+    if (!s) return;
+    for (size_t i = 0; i < s->count; i++) needle_free(&s->needles[i]);
+    kno_free(s->needles);
+    kno_free(s);
+}
+
+kno_filter *kno_filter_compile(const char *expr, const char **err) {
+    kno_filter *f = (kno_filter *)kno_calloc(1, sizeof(*f));
+    const char *msg;
+    if (!f) {
+        if (err) *err = "out of memory";
+        return NULL;
+    }
+    msg = filter_compile(&f->filter, expr ? expr : "");
+    if (msg) {
+        if (err) *err = msg;
+        kno_free(f);
+        return NULL;
+    }
+    return f;
+}
+
+int kno_filter_match(const kno_filter *f, const char *url, size_t len, int cat) {
+    char buf[1024], *heap;
+    const char *u = lib_cstr(url, len, buf, sizeof(buf), &heap);
+    if (!u) return 0;
+    int hit = filter_eval(&f->filter, u, len, cat);
+    kno_free(heap);
+    return hit;
+}
+
+void kno_filter_free(kno_filter *f) {
+    if (!f) return;
+    filter_free(&f->filter);
+    kno_free(f);
+}
+
+long kno_render(const char *buf, size_t len, const kno_render_opts *opts, kno_url_cb cb, void *user) {
+    HtmlOptions o;
+    RunStats rs;
+    StrList lines; sl_init(&lines);
+
+    if (!buf) return 0;
+    memset(&o, 0, sizeof(o));
+    memset(&rs, 0, sizeof(rs));
+    if (opts) {
+        for (int c = 0; c < CAT_BUILTIN_COUNT; c++) {
+            o.selected[c] = (opts->categories >> c) & 1u;
+            o.have_cat_flags |= o.selected[c];
+        }
+        o.no_media_mode = opts->no_media;
+        if (opts->search) {
+            o.needles = opts->search->needles;
+            o.nneedles = opts->search->count;
+        }
+        if (opts->filter) {
+            o.filter = opts->filter->filter;    /* borrowed; not freed here */
+            o.have_filter = 1;
+        }
+    }
+
+    render_page(buf, len, &o, &rs, NULL, &lines);
+    if (cb) {
+        for (size_t i = 0; i < lines.count; i++) {
+            if (cb(lines.items[i], strlen(lines.items[i]), user)) break;
+        }
+    }
+    sl_free(&lines);
+    return (long)rs.urls_kept;
+}
+
+typedef struct {
+    kno_body_cb cb;
+    void *user;
+} LibBodySink;
+
+static size_t lib_body_write(void *contents, size_t size, size_t nmemb, void *userp) {
+    LibBodySink *bs = (LibBodySink *)userp;
+    size_t n = size * nmemb;
+    return bs->cb((const char *)contents, n, bs->user) ? 0 : n;
+}
+
+int kno_fetch(const char *url, kno_body_cb cb, void *user, long *status) {
+    struct MemoryBuffer unused = { NULL, 0 };
+    LibBodySink bs = { cb, user };
+    CURLcode res;
+    CURL *curl;
+
+    if (status) *status = 0;
+    if (!url || !cb) return -1;
+    curl = curl_easy_init();
+    if (!curl) return -1;
+    fetch_setup_easy(curl, url, &unused, NULL);
+    fetch_setup_redirects(curl, FETCH_MAX_REDIRS);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, lib_body_write);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&bs);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    res = curl_easy_perform(curl);
+    if (status) curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, status);
+    curl_easy_cleanup(curl);
+    return res == CURLE_OK ? 0 : -1;
+}